@@ -12,23 +12,45 @@
 #define ATTACH_ASIDE    True      /* False means new window is master */
 #define FOLLOW_WINDOW   False     /* follow the window when moved to a different desktop */
 #define FOLLOW_MOUSE    False     /* focus the window the mouse just entered */
+#define FOCUS_DELAY     60        /* ms the mouse stays on a window before FOLLOW_MOUSE focuses it */
 #define CLICK_TO_FOCUS  False      /* focus an unfocused window when clicked  */
 #define FOCUS_BUTTON    Button1   /* mouse button to be used along with CLICK_TO_FOCUS */
 #define BORDER_WIDTH    2         /* window border width */
 #define FOCUS           "#ff950e" /* focused window border color    */
 #define UNFOCUS         "#444444" /* unfocused window border color  */
+#define MARK            "#5f87af" /* border color of windows marked for bulk actions */
 #define MINWSZ          50        /* minimum window size in pixels  */
 #define DEFAULT_DESKTOP 0         /* the desktop to focus initially */
 #define DESKTOPS        4         /* number of desktops - edit DESKTOPCHANGE keys to suit */
 #define STATUSFILE      "/tmp/status"
+#define NAME_DELAY      100       /* ms to wait before refetching a changed window title */
+#define SCREEN_DELAY    200       /* ms to wait for outputs to settle before monitors are read again */
+#define STALL_BUDGET    50        /* ms a handler may run before it is reported, 0 disables */
+#define STALL_RING      32        /* number of slow handlers kept for dumpstalls */
+#define SHM_STATE       True      /* publish the state page read by mwmstat, see mwmstate.h */
+#define RCFILE          "mwm/mwmrc" /* runtime bindings and settings, under $XDG_CONFIG_HOME or ~/.config */
+#define HIDE_STRATEGY   HIDE_UNMAP /* hide other desktops by HIDE_UNMAP, HIDE_MOVE or HIDE_ICONIC */
+#define NOTIFY_HOLD     8         /* notifications held while a fullscreen client is focused */
+#define NOTIFY_OSD      True      /* show notifications on screen, else over D-Bus if built with it */
+#define OSD_FONT        "-*-fixed-medium-r-*-*-13-*-*-*-*-*-*-*"
+#define OSD_FG          "#dddddd" /* on-screen display text color */
+#define OSD_BG          "#222222" /* on-screen display background color */
+#define SWITCH_LINES    10        /* matches shown at once by the switcher */
+#define SWITCH_TIMEOUT  30000     /* ms the switcher is shown without a key pressed */
+#define OVERVIEW        False     /* redirect clients to keep thumbnails, needs Composite, Damage and Render */
+#define OVERVIEW_SIZE   320       /* longest side of a thumbnail in pixels */
+#define PRIORITIES      False     /* renice client processes by what is shown, see priorities */
+#define FREEZE_DELAY    5000      /* ms clients of a freeze rule are hidden before being frozen */
+#define SCRATCH_RESPAWN 10000     /* ms a scratchpad must have run to be launched again when it exits */
 /**
  * open applications to specified desktop with specified mode.
- * if desktop is negative, then current is assumed
+ * if desktop is negative, then current is assumed. freeze stops
+ * the process group while all of its windows are on hidden desktops
  */
 static const Rule rules[] = { \
-  /*  class     mon desktop  follow */
-  { "MPlayer",  0,   3,    True },
-  { "Gimp",     0,   0,    False },
+  /*  class     mon desktop  follow  freeze */
+  { "MPlayer",  0,   3,    True,   False },
+  { "Gimp",     0,   0,    False,  False },
 };
 /* helper for spawning shell commands */
 #define SHCMD(cmd) { .cmd = (const char *[]) { "/bin/sh", "-c", cmd, NULL } }
@@ -38,6 +60,28 @@ static const Rule rules[] = { \
  */
 static const char *termcmd[] = { "term",      NULL };
 static const char *menucmd[] = { "dmenu_run", NULL };
+/**
+ * scratchpads kept running hidden and toggled onto the
+ * current desktop by scratchpad { .i = index }, their
+ * window is recognized by its class or instance name
+ */
+static const Scratchpad scratchpads[] = {
+  /*  class         start  command */
+  { "scratchpad",   True,  (const char *[]) { "st", "-c", "scratchpad", NULL } },
+};
+
+/**
+ * cpu and io priority of the processes of the focused client, of the
+ * other shown ones and of those only on hidden desktops, if PRIORITIES.
+ * a nice value lower than a process already had needs a raised
+ * RLIMIT_NICE (or CAP_SYS_NICE), io levels go from 0 (highest) to 7
+ */
+static const Priority priorities[] = {
+  /*               nice  io class            io level */
+  [PRIO_FOCUS]  = {  -5, IOPRIO_CLASS_BE,    0 },
+  [PRIO_SHOWN]  = {   0, IOPRIO_CLASS_NONE,  0 },
+  [PRIO_HIDDEN] = {  10, IOPRIO_CLASS_IDLE,  0 },
+};
 
 #define DESKTOPCHANGE(K,N) \
 {  MOD4,                             K,              to_client, { .i = N } }, \
@@ -55,6 +99,9 @@ static Key keys[] = {
   { MOD4|SHIFT,       XK_c,          killclient,        { NULL } },
   { MOD4,             XK_Tab,        next_win,          { NULL } },
   { MOD4|SHIFT,       XK_Tab,        prev_win,          { NULL } },
+  { MOD4,             XK_semicolon,  last_win,          { NULL } },
+  { MOD1,             XK_Tab,        cycle_win,         { .i = +1 } }, /* older, until Alt is released */
+  { MOD1|SHIFT,       XK_Tab,        cycle_win,         { .i = -1 } }, /* newer */
   { MOD4,             XK_space,      status,            { NULL } },
   { MOD4,             XK_h,          resize_master,     { .i = -10 } }, /* decrease size in px */
   { MOD4,             XK_l,          resize_master,     { .i = +10 } }, /* increase size in px */
@@ -78,6 +125,12 @@ static Key keys[] = {
   { MOD4|SHIFT,       XK_Return,     spawn,             { .cmd = termcmd } },
   { MOD4,             XK_Escape,     spawn,             { .cmd = menucmd } },
   { MOD4,             XK_s,          togglefixed,       { NULL } },
+  { MOD4,             XK_apostrophe, scratchpad,        { .i = 0 } },
+  { MOD4,             XK_x,          togglemark,        { NULL } }, /* bulk: client_to_*, killclient, togglefixed */
+  { MOD4,             XK_slash,      switcher,          { NULL } }, /* search clients of all desktops */
+  { MOD4,             XK_e,          overview,          { NULL } }, /* thumbnails of all desktops */
+  { MOD4|CTRL,        XK_d,          dumpstalls,        { NULL } },
+  { MOD4|CTRL,        XK_r,          reload,            { NULL } },
   { MOD4|CTRL,        XK_j,          moveresize,        { .v = (int []) {   0,  25,   0,   0 } } }, /* move down  */
   { MOD4|CTRL,        XK_k,          moveresize,        { .v = (int []) {   0, -25,   0,   0 } } }, /* move up    */
   { MOD4|CTRL,        XK_l,          moveresize,        { .v = (int []) {  25,   0,   0,   0 } } }, /* move right */
@@ -4,30 +4,69 @@
 #include <stdio.h>
 #include <err.h>
 #include <stdarg.h>
+#include <errno.h>
 #include <unistd.h>
 #include <string.h>
 #include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <locale.h>
+#include <sys/mman.h>
+#include <sys/select.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <X11/Xutil.h>
 #include <X11/XKBlib.h>
 #include <X11/Xproto.h>
 #include <X11/Xatom.h>
 #include <X11/extensions/Xinerama.h>
+#include <X11/extensions/Xrandr.h>
+#ifdef BACKTRACE
+#include <execinfo.h>
+#endif
 #include "dbus.h"
+#include "osd.h"
+#include "overview.h"
+#include "search.h"
+#include "strtab.h"
+#include "mwmstate.h"
+#include "rc.h"
 
 #define LENGTH(x)             (sizeof(x) / sizeof(*x))
+#define MAX(a, b)             ((a) > (b) ? (a) : (b))
+#define MIN(a, b)             ((a) < (b) ? (a) : (b))
 #define CLEANMASK(mask)       (mask & ~(numlockmask | LockMask))
 #define BUTTONMASK            ButtonPressMask | ButtonReleaseMask
 #define ISIMM(c)              (c->isfixed || c->istrans)
+#define LAYER(c)              (c->isfull ? LAYER_FULL : ISIMM(c) || c->isnotif ? LAYER_FLOAT : LAYER_TILED)
 #define ROOTMASK              SubstructureRedirectMask | ButtonPressMask | SubstructureNotifyMask | PropertyChangeMask
-#define NOTIFY(body, urg, to) notify_send("mwm", body, urg, to)
+#define CLIENTMASK            (PropertyChangeMask | FocusChangeMask | (cfg.followmouse ? EnterWindowMask : 0))
+#define NOTIFY(body, urg, to) notify(body, urg, to)
+#define CGROUP_ROOT           "/sys/fs/cgroup" /* where cgroup v2 is mounted */
+#define THAW_WAIT             100 /* ms a cgroup is given to report it is thawed */
+/* a fullscreen client is focused on the shown desktop of m */
+#define ISGAME(m)             ((m)->desktops[(m)->currdeskidx].curr && (m)->desktops[(m)->currdeskidx].curr->isfull)
 
 enum { QUIT, RESTART };
 enum { RESIZE, MOVE };
 enum { MONOCLE, TILE, BSTACK, GRID, MODES };
-enum { WM_PROTOCOLS, WM_DELETE_WINDOW, WM_COUNT };
-enum { NET_SUPPORTED, NET_FULLSCREEN, NET_WM_STATE, NET_ACTIVE, 
-        NET_WMNAME, NET_WTYPE, NET_NOTIF, NET_UTIL, NET_COUNT };
+enum { HIDE_UNMAP, HIDE_MOVE, HIDE_ICONIC };
+enum { LAYER_FULL, LAYER_FLOAT, LAYER_TILED };
+enum { PRIO_FOCUS, PRIO_SHOWN, PRIO_HIDDEN, PRIOS };
+/* as in linux/ioprio.h, which glibc does not wrap */
+enum { IOPRIO_CLASS_NONE, IOPRIO_CLASS_RT, IOPRIO_CLASS_BE, IOPRIO_CLASS_IDLE };
+enum { IOPRIO_WHO_PROCESS = 1, IOPRIO_WHO_PGRP };
+enum { WM_PROTOCOLS, WM_DELETE_WINDOW, WM_STATE, WM_COUNT };
+enum { NET_SUPPORTED, NET_FULLSCREEN, NET_HIDDEN, NET_WM_STATE, NET_ACTIVE, 
+        NET_WMNAME, NET_WTYPE, NET_NOTIF, NET_UTIL, NET_CLIENTS, NET_STACKING,
+        NET_NDESKTOPS, NET_CURRDESKTOP, NET_WMDESKTOP, NET_VIEWPORT, NET_PID, NET_COUNT };
+enum { NAMETIMER, RCTIMER, FREEZETIMER, SCREENTIMER, OSDTIMER, FOCUSTIMER, SWITCHTIMER, TIMERS };
+enum { ARG_NONE, ARG_INT, ARG_CMD, ARG_MOVE };
+enum { SET_FLOAT, SET_INT, SET_BOOL, SET_COLOR };
 
 typedef union {
   const char **cmd;
@@ -53,12 +92,25 @@ typedef struct {
   const int monitor;
   const int desktop;
   const Bool follow;
+  const Bool freeze; /* stopped while only on hidden desktops, see FREEZE_DELAY */
 } Rule;
 
+typedef struct {
+  const char *class; /* by which its window is recognized */
+  const Bool start; /* launched at startup, else on first use */
+  const char **cmd;
+} Scratchpad;
+
+typedef struct {
+  const int nice;
+  const int ioclass, iolevel; /* IOPRIO_CLASS_NONE follows the nice value */
+} Priority;
+
 static void change_desktop(const Arg *);
 static void change_monitor(const Arg *);
 static void client_to_desktop(const Arg *);
 static void client_to_monitor(const Arg *);
+static void dumpstalls();
 static void focusurgent();
 static void killclient();
 static void last_desktop();
@@ -67,16 +119,23 @@ static void move_up();
 static void moveresize(const Arg *);
 static void mousemotion(const Arg *);
 static void next_win();
+static void overview();
+static void last_win();
+static void cycle_win(const Arg *);
 static void prev_win();
 static void quit(const Arg *);
+static void reload();
 static void resize_master(const Arg *);
 static void resize_stack(const Arg *);
 static void rotate(const Arg *);
 static void rotate_filled(const Arg *);
+static void scratchpad(const Arg *);
 static void spawn(const Arg *);
 static void swap_master();
 static void status();
+static void switcher();
 static void togglefixed();
+static void togglemark();
 static void setlayout(const Arg *);
 static void setfloating();
 static void to_client(const Arg *);
@@ -85,47 +144,170 @@ static void to_client(const Arg *);
 
 typedef struct Client {
   struct Client *next;
-  Bool isurgn, ismono, isfull, istrans, isfixed;
+  struct Client *mrunext, *mruprev; /* ring of the desktop, most recently focused first */
+  Bool isurgn, ismono, isfull, istrans, isfixed, isnotif, isnamedirty, ishidden, isdirty;
+  Bool ismarked; /* for the next bulk action, see selection */
+  Bool isfreeze; /* of a rule that freezes it while hidden */
+  Bool isfocusgrab; /* FOCUS_BUTTON is grabbed */
+  unsigned int grabgen; /* buttons[] are grabbed as of that grabgen, 0 if not */
   Window win;
-  int x, y, w, h;
-  char NAME[64];
+  int x, y, w, h; /* as last configured, see configurenotify */
+  unsigned long cfgserial; /* of the last geometry sent by configclient */
+  long desktop; /* last published _NET_WM_DESKTOP */
+  int slot; /* in the state page, -1 if none */
+  pid_t pid; /* from _NET_WM_PID, 0 if unknown */
+  int prio; /* class it is counted in by its Proc, -1 if none */
+  int search; /* entry in the switcher index, see search.c */
+  const char *name, *class, *inst; /* interned, see strtab.c */
 } Client;
 
+/* an area of a monitor, relative to its origin */
+typedef struct {
+  int x, y, w, h;
+} Rect;
+
 typedef struct {
   int mode, masz, sasz;
+  Bool isdirty; /* focus changed while not shown */
+  Bool isunarranged; /* the layout was put off by a fullscreen client */
   Client *head, *curr, *prev;
+  Client *mru; /* most recently focused, see mrulink */
+  Window *stack; /* last stacking order sent, top first */
+  int nstack;
+  Rect *space; /* maximal areas free of placed clients */
+  int nspace, spacesz;
+  Bool isspacevalid; /* else rebuilt on the next placement */
 } Desktop;
 
+/* a handler that ran longer than STALL_BUDGET */
+typedef struct {
+  long long ms;
+  int type, key; /* event type or -1 for timer key, index in keys[] or timeouts[] */
+  Window win;
+  KeySym keysym; /* keys[] may have been reloaded since */
+} Stall;
+
+/* what a window asks for, fetched before it is managed */
+typedef struct {
+  Window win;
+  XWindowAttributes wa;
+  Bool istrans, isfull, isnotif, isfreeze;
+  pid_t pid;
+  const char *class, *inst, *name; /* interned, handed over to the client */
+} Hints;
+
+/* a process with managed clients, and how many are in each class */
+typedef struct {
+  pid_t pid;
+  Bool isgroup; /* leads its process group, which gets the priority */
+  int prio; /* applied, PRIO_SHOWN is assumed until then */
+  int n[PRIOS];
+  int nfreeze; /* clients of a rule that freezes */
+  Bool isfrozen, iscgroupknown;
+  Bool isthawing; /* its cgroup was thawed and is not waited for yet */
+  long long freezeat; /* when it is due to be frozen, 0 if not */
+  char *cgroup; /* cgroup.freeze of the cgroup it owns, NULL to signal it */
+} Proc;
+
+/* a scratchpad slot of config.h, its client is managed while hidden */
+typedef struct {
+  Client *c; /* on no desktop while hidden, NULL until its window is mapped */
+  pid_t pid; /* of the last launch, 0 if never launched */
+  Bool wantshow; /* toggled on before its window was mapped */
+  Bool iskilled; /* closed with killclient, not launched again */
+  long long launched; /* ms of the last launch */
+} Scratch;
+
+/* bindings and settings in use, those of config.h or of RCFILE */
+typedef struct {
+  const Key *keys;
+  const Button *buttons;
+  const Rule *rules;
+  unsigned int nkeys, nbuttons, nrules;
+  float mastersize;
+  int borderwidth, minwsz;
+  Bool attachaside, followmouse, followwindow, clicktofocus, notifyosd;
+  const char *focus, *unfocus, *mark;
+  void **allocs; /* what a config read from RCFILE owns */
+  unsigned int nallocs;
+} Config;
+
+/* tables being filled while RCFILE is read */
+typedef struct {
+  Config *cfg;
+  Key *keys;
+  Button *buttons;
+  Rule *rules;
+  unsigned int nkeys, nbuttons, nrules;
+} Rc;
+
 typedef struct Monitor {
   int x, y, h, w, currdeskidx, prevdeskidx;
   Desktop desktops[DESKTOPS];
 } Monitor;
 
-static Client *addwindow(Window, Desktop *);
+static Client *addwindow(const Hints *, Desktop *);
 static void buttonpress(XEvent *);
 static void cleanup();
 static void clientmessage(XEvent *);
 static void configurerequest(XEvent *);
+static void configurenotify(XEvent *);
 static void deletewindow(Window);
 static void destroynotify(XEvent *);
 static void enternotify(XEvent *);
+static void focuspointer(void);
+static void markcrossings(void);
 static void focus(Client *, Desktop *, Monitor *);
 static void focusin(XEvent *);
-static unsigned long getcolor(const char *, const int);
+static Bool getcolor(const char *, unsigned long *);
 static void grabbuttons(Client *);
 static void grabkeys(void);
+static void grabkey(const Key *, const Bool);
+static void regrabbuttons(void);
+static void updatenumlock(void);
+static void mappingnotify(XEvent *);
 static void grid(int, int, int, int, const Desktop *);
 static void keypress(XEvent *);
+static void keyrelease(XEvent *);
+static void endcycle(void);
 static void maprequest(XEvent *);
-static void maprequest_window(Monitor *, Desktop *, Client *, Window, const XWindowAttributes *);
+static Client *maprequest_window(const Hints *, Desktop **, Monitor **);
+static void gethints(Window, Hints *);
+static void adopt(void);
 static void monocle(int, int, int, int, const Desktop *);
 static Client *prevclient(Client *, Desktop *);
 static void propertynotify(XEvent *);
 static void removeclient(Client *, Desktop *, Monitor *);
+static Bool unlinkclient(Client *, Desktop *, Monitor *);
+static void mrulink(Client *, Desktop *, Bool);
+static void mruunlink(Client *, Desktop *);
+static void freeclient(Client *);
+static Bool selection(Desktop *);
+static Client *unlinkmarked(Desktop *);
+static void linkclients(Client *, Desktop *);
 static void run(void);
-static void setfullscreen(Client *, Monitor *, Bool);
+static void setfullscreen(Client *, Desktop *, Monitor *, Bool);
+static void setnetstate(const Client *);
+static void hideclient(Client *, const Monitor *);
+static void showclient(Client *, const Monitor *);
+static pid_t clientpid(Window);
+static void setprio(Client *, const Bool);
+static void setfocusprio(Client *);
+static void applyprios(void);
+static void reniceproc(Proc *, const int);
+static const Rule *matchrule(const Hints *);
+static void freezeprocs(void);
+static void freezeproc(Proc *, const Bool);
+static Bool procgroup(Proc *);
+static Bool cgroupof(const pid_t, char *, const size_t);
+static void waitthaws(void);
+static void thawdesktop(const Desktop *);
+static void parkscratch(Client *, const Monitor *, Bool);
+static Scratch *scratchfor(const Hints *);
+static Bool isscratchwin(Window);
 static void setup(void);
 static void sigchld(int);
+static pid_t spawncmd(const char **);
 static void stack(int, int, int, int, const Desktop *);
 static void unmapnotify(XEvent *);
 static Bool wintoclient(Window, Client **, Desktop **, Monitor **);
@@ -134,18 +316,88 @@ static int xerrorstart(Display *, XErrorEvent *);
 static void desktopinfo(const Monitor *);
 static void clientinfo(const Monitor *);
 static void coverfree(Client *, Desktop *, Monitor *);
-static void covercenter(Client *, Monitor *);
-static void clientname(Client *);
+static void covercenter(Client *, Desktop *, Monitor *);
+static void spacebuild(Desktop *, const Monitor *, const Client *);
+static void spaceuse(Desktop *, Rect);
+static Bool spacefit(const Desktop *, int, int, int *, int *);
+static Bool placeclient(Client *, const Desktop *, const Monitor *);
+static void moveclient(Client *, const Monitor *);
+static void configclient(Client *, int, int, int, int);
+static Bool clientname(Client *);
+static const char *getname(Window);
+static void updatenames(void);
+static long long now(void);
+static void settimer(const int, const int);
+static void addclientlist(Window);
+static void removeclientlist(Window);
+static void raiseclientlist(const Window *, int);
+static void restack(Monitor *);
+static void setclientdesktop(Client *, const Monitor *, const Desktop *);
+static void setcurrentdesktop(void);
+static void setdesktops(void);
+static void updatemons(void);
+static void joindesktop(Desktop *, const Monitor *, Desktop *, const Monitor *);
+static void relayout(Desktop *, Monitor *, const int, const int);
+static void watch(const int, const int, const Window);
+static long long unwatch(const long long);
+static void *watchdog(void *);
+static void printstall(const char *, const Stall *);
+static void watchkey(const int, const KeySym);
+static void notify(const char *, const unsigned char, const unsigned int);
+static void sendnotify(const char *, const unsigned char, const unsigned int);
+static void stateopen(void);
+static void stateclose(void);
+static void statemonitor(const Monitor *);
+static void statedesktop(const Monitor *, const Desktop *);
+static void stateclient(const Client *);
+static void statebegin(void);
+static uint32_t clientflags(const Client *);
+static void stateend(void);
+#ifdef BACKTRACE
+static void stacksample(int);
+#endif
 static void arrange(Desktop *, Monitor *, const int);
 static void listclients(Desktop *);
+static void switcherkey(XEvent *);
+static void showswitcher(void);
+static void endswitcher(void);
+static void jumpto(Client *);
+static void overviewkey(XEvent *);
+static void loadrc(void);
+static void readrc(Config *);
+static void rcline(int, char *[], int, void *);
+static void *rcown(Config *, void *);
+static Bool rcarg(const int, int, char *[], Config *, Arg *);
+static Bool rcint(const char *, int *);
+static Bool rcmods(char *, unsigned int *);
+static void freeconfig(Config *);
+static void sighup(int);
 
-static Bool running = True;
+static Bool running = True, adopting, startupreport, iscycling, isswitching, isoverview;
+/* what is typed to the switcher and the line chosen of what it matches */
+static char switchquery[64];
+static int switchsel;
+/* the windows the overview shows, the chosen one and the columns of its grid */
+static Window *overviewwins;
+static int noverviewwins, overviewwinssz, overviewsel, overviewcols;
 static int nmons, currmonidx, retval;
-static unsigned int numlockmask, win_focus, win_unfocus, win_infocus;
+static unsigned int numlockmask, lockmods[4], nlockmods, grabgen = 1;
+static unsigned long win_focus, win_unfocus, win_infocus, win_mark;
 static Display *dpy;
 static Window root;
 static Atom wmatoms[WM_COUNT], netatoms[NET_COUNT];
+static int rrevbase = -1; /* first RandR event, -1 without RandR */
 static Monitor *mons;
+/* managed windows in order of mapping and bottom to top stacking */
+static Window *clientlist, *stacklist;
+static int nclientlist, clientlistsz;
+static Scratch scratch[LENGTH(scratchpads)];
+static long currdesktop = -1;
+/* processes of the clients, by setprio, and the client counted as focused */
+static Proc *procs;
+static int nprocs, procssz;
+static Bool isprodirty;
+static Client *prioclient;
 
 static void (*events[LASTEvent])(XEvent *) = {
   [KeyPress]         = keypress,     [EnterNotify]    = enternotify,
@@ -153,6 +405,152 @@ static void (*events[LASTEvent])(XEvent *) = {
   [ButtonPress]      = buttonpress,  [DestroyNotify]  = destroynotify,
   [UnmapNotify]      = unmapnotify,  [PropertyNotify] = propertynotify,
   [ConfigureRequest] = configurerequest, [FocusIn] = focusin,
+  [MappingNotify]    = mappingnotify, [KeyRelease] = keyrelease,
+  [ConfigureNotify]  = configurenotify,
+};
+
+static void (*timeouts[TIMERS])(void) = {
+  [NAMETIMER] = updatenames, [RCTIMER] = loadrc, [FREEZETIMER] = freezeprocs,
+  [SCREENTIMER] = updatemons, [OSDTIMER] = osd_hide, [FOCUSTIMER] = focuspointer,
+  [SWITCHTIMER] = endswitcher,
+};
+
+/* absolute expiry of each armed timer in ms, 0 if disarmed */
+static long long deadlines[TIMERS];
+/* set by SIGHUP, which also writes to the pipe to wake run() */
+static volatile sig_atomic_t ishup;
+static int hupfds[2] = { -1, -1 };
+
+static const char *evnames[LASTEvent] = {
+  [KeyPress] = "KeyPress", [KeyRelease] = "KeyRelease", [ButtonPress] = "ButtonPress",
+  [ButtonRelease] = "ButtonRelease", [MotionNotify] = "MotionNotify", [EnterNotify] = "EnterNotify",
+  [LeaveNotify] = "LeaveNotify", [FocusIn] = "FocusIn", [FocusOut] = "FocusOut",
+  [KeymapNotify] = "KeymapNotify", [Expose] = "Expose", [GraphicsExpose] = "GraphicsExpose",
+  [NoExpose] = "NoExpose", [VisibilityNotify] = "VisibilityNotify", [CreateNotify] = "CreateNotify",
+  [DestroyNotify] = "DestroyNotify", [UnmapNotify] = "UnmapNotify", [MapNotify] = "MapNotify",
+  [MapRequest] = "MapRequest", [ReparentNotify] = "ReparentNotify", [ConfigureNotify] = "ConfigureNotify",
+  [ConfigureRequest] = "ConfigureRequest", [GravityNotify] = "GravityNotify", [ResizeRequest] = "ResizeRequest",
+  [CirculateNotify] = "CirculateNotify", [CirculateRequest] = "CirculateRequest",
+  [PropertyNotify] = "PropertyNotify", [SelectionClear] = "SelectionClear",
+  [SelectionRequest] = "SelectionRequest", [SelectionNotify] = "SelectionNotify",
+  [ColormapNotify] = "ColormapNotify", [ClientMessage] = "ClientMessage",
+  [MappingNotify] = "MappingNotify", [GenericEvent] = "GenericEvent",
+};
+
+/**
+ * the handler being run and the last STALL_RING slow ones.
+ * dispatches is odd while a handler runs, the watchdog thread
+ * reports a handler if it is still the same after a full budget.
+ * watched is only written while dispatches is even, so it is read
+ * as the state page is, and discarded if dispatches changed.
+ */
+static Stall watched, stalls[STALL_RING];
+static unsigned int nstalls;
+static unsigned long dispatches;
+#ifdef BACKTRACE
+static pthread_t mainthread;
+#endif
+/* shared memory state page and its free client slots */
+static MwmState *state;
+static int freeslots[MWMSTATE_CLIENTS], nfreeslots, noslots;
+/* geometry and focus passes put off for desktops that are not shown,
+ * done once shown, or dropped as superseded or no longer needed */
+static unsigned int ndeferred, napplied, ndiscarded;
+/* work put off or left out while a fullscreen client is focused */
+static unsigned int ngamearranges, ngamenotifies, ngamedropped, ngameborders, ngamecrossings, ngamestacks;
+/* crossings taken for mwm moving windows, and passed over by the pointer before FOCUS_DELAY */
+static unsigned int nowncrossings, nsweptcrossings;
+/* windows were moved, mapped or restacked since markcrossings, crossings
+ * of requests before crossingserial were caused by mwm, see enternotify */
+static Bool ismoved;
+static unsigned long crossingserial;
+/* ConfigureNotify taken into the client geometry, and older than what mwm sent since */
+static unsigned int nconfnotifies, nstaleconfnotifies;
+/* the ButtonPress a button binding was called for, NULL if none */
+static const XButtonEvent *press;
+/* the KeyPress a key binding was called for, NULL if none */
+static const XKeyEvent *keypressed;
+/* the modifiers of each keycode, and those held to go on cycling */
+static unsigned char keymods[256];
+static unsigned int cyclemods;
+/* the window the pointer entered last, focused once it stays */
+static Window pointerwin;
+/* notifications held back meanwhile, the oldest are dropped */
+static struct {
+  char body[256];
+  unsigned char urg;
+  unsigned int to;
+} notifyq[NOTIFY_HOLD];
+static unsigned int nnotifyq;
+static int osd = -1; /* whether osd_open succeeded, -1 until it is first needed */
+
+static Config cfg;
+static const Config defcfg = {
+  keys, buttons, rules, LENGTH(keys), LENGTH(buttons), LENGTH(rules),
+  MASTER_SIZE, BORDER_WIDTH, MINWSZ, ATTACH_ASIDE, FOLLOW_MOUSE, FOLLOW_WINDOW,
+  CLICK_TO_FOCUS, NOTIFY_OSD, FOCUS, UNFOCUS, MARK, NULL, 0,
+};
+/* path of RCFILE, for messages */
+static char rcpath[512];
+
+static const struct {
+  const char *name;
+  void (*func)(const Arg *);
+  int arg;
+} actions[] = {
+  { "change_desktop", change_desktop, ARG_INT },   { "change_monitor", change_monitor, ARG_INT },
+  { "client_to_desktop", client_to_desktop, ARG_INT }, { "client_to_monitor", client_to_monitor, ARG_INT },
+  { "dumpstalls", dumpstalls, ARG_NONE },          { "focusurgent", focusurgent, ARG_NONE },
+  { "killclient", killclient, ARG_NONE },          { "last_desktop", last_desktop, ARG_NONE },
+  { "move_down", move_down, ARG_NONE },            { "move_up", move_up, ARG_NONE },
+  { "moveresize", moveresize, ARG_MOVE },          { "mousemotion", mousemotion, ARG_INT },
+  { "next_win", next_win, ARG_NONE },              { "prev_win", prev_win, ARG_NONE },
+  { "overview", overview, ARG_NONE },
+  { "last_win", last_win, ARG_NONE },              { "cycle_win", cycle_win, ARG_INT },
+  { "quit", quit, ARG_INT },                       { "reload", reload, ARG_NONE },
+  { "resize_master", resize_master, ARG_INT },     { "resize_stack", resize_stack, ARG_INT },
+  { "rotate", rotate, ARG_INT },                   { "rotate_filled", rotate_filled, ARG_INT },
+  { "spawn", spawn, ARG_CMD },                     { "swap_master", swap_master, ARG_NONE },
+  { "status", status, ARG_NONE },                  { "togglefixed", togglefixed, ARG_NONE },
+  { "togglemark", togglemark, ARG_NONE },          { "switcher", switcher, ARG_NONE },
+  { "setlayout", setlayout, ARG_INT },             { "setfloating", setfloating, ARG_NONE },
+  { "scratchpad", scratchpad, ARG_INT },           { "to_client", to_client, ARG_INT },
+};
+
+/* names that integer arguments may be given by */
+static const struct {
+  const char *name;
+  int i;
+} argnames[] = {
+  { "monocle", MONOCLE }, { "tile", TILE }, { "bstack", BSTACK }, { "grid", GRID },
+  { "quit", QUIT }, { "restart", RESTART }, { "move", MOVE }, { "resize", RESIZE },
+};
+
+static const struct {
+  const char *name;
+  unsigned int mask;
+} modnames[] = {
+  { "None", 0 }, { "Shift", ShiftMask }, { "Lock", LockMask }, { "Ctrl", ControlMask },
+  { "Control", ControlMask }, { "Mod1", Mod1Mask }, { "Mod2", Mod2Mask },
+  { "Mod3", Mod3Mask }, { "Mod4", Mod4Mask }, { "Mod5", Mod5Mask },
+};
+
+static const struct {
+  const char *name;
+  int type;
+  size_t offset;
+} setnames[] = {
+  { "master_size", SET_FLOAT, offsetof(Config, mastersize) },
+  { "border_width", SET_INT, offsetof(Config, borderwidth) },
+  { "min_size", SET_INT, offsetof(Config, minwsz) },
+  { "attach_aside", SET_BOOL, offsetof(Config, attachaside) },
+  { "follow_mouse", SET_BOOL, offsetof(Config, followmouse) },
+  { "follow_window", SET_BOOL, offsetof(Config, followwindow) },
+  { "click_to_focus", SET_BOOL, offsetof(Config, clicktofocus) },
+  { "notify_osd", SET_BOOL, offsetof(Config, notifyosd) },
+  { "focus_color", SET_COLOR, offsetof(Config, focus) },
+  { "unfocus_color", SET_COLOR, offsetof(Config, unfocus) },
+  { "mark_color", SET_COLOR, offsetof(Config, mark) },
 };
 
 static void (*layout[MODES])(int, int, int, int, const Desktop *) = {
@@ -170,14 +568,18 @@ static void (*layout[MODES])(int, int, int, int, const Desktop *) = {
  * add the window as the last client
  * otherwise add the window as head
  */
-Client *addwindow(Window w, Desktop *d) {
-  Client *c = NULL, *t = prevclient(d->head, d);
+Client *addwindow(const Hints *h, Desktop *d) {
+  Client *c = NULL, *t = d ? prevclient(d->head, d) : NULL;
   if (!(c = (Client *) calloc(1, sizeof *c)))
     err(EXIT_FAILURE, "cannot allocate client");
 
-  if (!d->head)
+  if (d)
+    mrulink(c, d, False);
+  if (!d)
+    ; /* a hidden scratchpad */
+  else if (!d->head)
     d->head = c;
-  else if (!ATTACH_ASIDE) {
+  else if (!cfg.attachaside) {
     c->next = d->head; 
     d->head = c;
   } else if (t) 
@@ -185,7 +587,24 @@ Client *addwindow(Window w, Desktop *d) {
   else 
     d->head->next = c;
 
-  XSelectInput(dpy, (c->win = w), PropertyChangeMask | FocusChangeMask | (FOLLOW_MOUSE ? EnterWindowMask : 0));
+  XSelectInput(dpy, (c->win = h->win), CLIENTMASK);
+  c->class = h->class;
+  c->inst = h->inst;
+  c->name = h->name;
+  c->istrans = h->istrans;
+  c->isnotif = h->isnotif;
+  c->w = h->wa.width;
+  c->h = h->wa.height;
+  c->desktop = -1;
+  c->pid = h->pid;
+  c->isfreeze = h->isfreeze;
+  c->prio = -1;
+  setprio(c, False);
+  if ((c->slot = nfreeslots ? freeslots[--nfreeslots] : -1) < 0)
+    noslots++;
+  search_set((c->search = search_add(c)), c->name, c->class);
+  overview_track(c->win, c->w, c->h, h->wa.visual, h->wa.map_state == IsViewable);
+  addclientlist(c->win);
   return c;
 }
 
@@ -200,20 +619,22 @@ void buttonpress(XEvent *e) {
   while (m != &mons[cm] && cm < nmons)
     ++cm;
 
-  if (w && CLICK_TO_FOCUS && e->xbutton.button == FOCUS_BUTTON && (c != d->curr || cm != currmonidx)) {
+  if (w && cfg.clicktofocus && e->xbutton.button == FOCUS_BUTTON && (c != d->curr || cm != currmonidx)) {
     if (cm != currmonidx)
       change_monitor(&(Arg){ .i = cm });
     focus(c, d, m);
   }
 
-  for (unsigned int i = 0; i < LENGTH(buttons); i++)
-    if (CLEANMASK(buttons[i].mask) == CLEANMASK(e->xbutton.state) &&
-          buttons[i].func && buttons[i].button == e->xbutton.button) {
+  for (unsigned int i = 0; i < cfg.nbuttons; i++)
+    if (CLEANMASK(cfg.buttons[i].mask) == CLEANMASK(e->xbutton.state) &&
+          cfg.buttons[i].func && cfg.buttons[i].button == e->xbutton.button) {
       if (w && cm != currmonidx)
         change_monitor(&(Arg){ .i = cm });
       if (w && c != d->curr)
         focus(c, d, m);
-      buttons[i].func(&(buttons[i].arg));
+      press = &e->xbutton;
+      cfg.buttons[i].func(&(cfg.buttons[i].arg));
+      press = NULL;
     }
 }
 
@@ -231,19 +652,32 @@ void change_desktop(const Arg *arg) {
   if (arg->i == m->currdeskidx + 1 || arg->i < 0 || arg->i > DESKTOPS)
     return;
   Desktop *d = &m->desktops[(m->prevdeskidx = m->currdeskidx)], *n = &m->desktops[(m->currdeskidx = arg->i - 1)];
-  if (n->curr)
-    XMapWindow(dpy, n->curr->win);
+  thawdesktop(n);
+  /* nothing is drawn in between, clients see one transition */
+  XGrabServer(dpy);
+  /* mapped bottom first, the clients come back in the order they were stacked */
+  for (int i = n->nstack - 1; i >= 0; i--)
+    for (Client *c = n->head; c; c = c->next)
+      if (c->win == n->stack[i] && c->ishidden)
+        showclient(c, m);
   for (Client *c = n->head; c; c = c->next)
-    XMapWindow(dpy, c->win);
-  XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = SubstructureNotifyMask });
+    if (c->ishidden)
+      showclient(c, m);
+  if (HIDE_STRATEGY != HIDE_MOVE)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = SubstructureNotifyMask });
   for (Client *c = d->head; c; c = c->next)
     if (c != d->curr)
-      XUnmapWindow(dpy, c->win);
+      hideclient(c, m);
   if (d->curr)
-    XUnmapWindow(dpy, d->curr->win);
-  XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .event_mask = ROOTMASK });
+    hideclient(d->curr, m);
+  if (HIDE_STRATEGY != HIDE_MOVE)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .event_mask = ROOTMASK });
   if (n->head)
     focus(n->curr, n, m);
+  applyprios();
+  XUngrabServer(dpy);
+  setcurrentdesktop();
+  statemonitor(m);
   desktopinfo(m);
 }
 
@@ -256,11 +690,24 @@ void change_monitor(const Arg *arg) {
   Monitor *m = &mons[currmonidx], *n = &mons[(currmonidx = arg->i)];
   focus(m->desktops[m->currdeskidx].curr, &m->desktops[m->currdeskidx], m);
   focus(n->desktops[n->currdeskidx].curr, &n->desktops[n->currdeskidx], n);
+  setcurrentdesktop();
+  statemonitor(n);
   desktopinfo(m);
 }
 
 void cleanup(void) {
   XUngrabKey(dpy, AnyKey, AnyModifier, root);
+  /* a frozen client could not close, nor be seen by the next wm,
+   * and a reniced one would stay behind or ahead of the others */
+  for (Proc *p = procs; p < procs + nprocs; p++)
+    if (p->isfrozen)
+      freezeproc(p, False);
+  waitthaws();
+  for (Proc *p = procs; p < procs + nprocs; p++) {
+    if (PRIORITIES && p->prio != PRIO_SHOWN)
+      reniceproc(p, PRIO_SHOWN);
+    free(p->cgroup);
+  }
   if (retval == QUIT) {
     Window root_return, parent_return, *children;
     unsigned int nchildren;
@@ -275,6 +722,17 @@ void cleanup(void) {
   }
 
   XSync(dpy, False);
+  stateclose();
+  osd_close();
+  overview_close();
+  free(overviewwins);
+  freeconfig(&cfg);
+  free(clientlist);
+  free(stacklist);
+  free(procs);
+  for (int m = 0; m < nmons; m++)
+    for (int d = 0; d < DESKTOPS; d++)
+      free(mons[m].desktops[d].stack), free(mons[m].desktops[d].space);
   free(mons);
 }
 
@@ -287,24 +745,30 @@ void cleanup(void) {
 void client_to_desktop(const Arg *arg) {
   Monitor *m = &mons[currmonidx];
   Desktop *d = &m->desktops[m->currdeskidx], *n = NULL;
-  if (arg->i == m->currdeskidx + 1 || arg->i < 0 || arg->i > DESKTOPS || !d->curr)
+  if (arg->i == m->currdeskidx + 1 || arg->i < 0 || arg->i > DESKTOPS || !selection(d))
     return;
 
-  Client *c = d->curr, *p = prevclient(d->curr, d),
-    *l = prevclient(m->desktops[arg->i].head, (n = &m->desktops[arg->i - 1]));
-  /* unlink current client from current desktop */
-  if (d->head == c || !p) 
-    d->head = c->next;
-  else 
-    p->next = c->next;
-  c->next = NULL;
-  XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = SubstructureNotifyMask });
-  if (XUnmapWindow(dpy, c->win))
-    focus(d->prev, d, m);
-  XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .event_mask = ROOTMASK });
-  /* link client to new desktop and make it the current */
-  focus(l ? (l->next = c) : n->head ? (n->head->next = c) : (n->head = c), n, m);
-  if (FOLLOW_WINDOW)
+  Client *curr = d->curr, *list = unlinkmarked(d);
+  if (d->curr)
+    curr = list;
+  n = &m->desktops[arg->i - 1];
+  /* nothing is drawn in between, clients see one transition */
+  XGrabServer(dpy);
+  if (HIDE_STRATEGY != HIDE_MOVE)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = SubstructureNotifyMask });
+  for (Client *c = list; c; c = c->next) {
+    hideclient(c, m);
+    setclientdesktop(c, m, n);
+  }
+  if (HIDE_STRATEGY != HIDE_MOVE)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .event_mask = ROOTMASK });
+  /* link the clients to the new desktop, the current one stays current
+   * there, a hidden client that is still mapped must not keep the input focus */
+  linkclients(list, n);
+  focus(curr, n, m);
+  focus(d->curr ? d->curr : d->mru, d, m);
+  XUngrabServer(dpy);
+  if (cfg.followwindow)
     change_desktop(arg);
 }
 
@@ -322,20 +786,22 @@ void client_to_desktop(const Arg *arg) {
 void client_to_monitor(const Arg *arg) {
   Monitor *cm = &mons[currmonidx], *nm = NULL;
   Desktop *cd = &cm->desktops[cm->currdeskidx], *nd = NULL;
-  if (arg->i == currmonidx || arg->i < 0 || arg->i >= nmons || !cd->curr)
+  if (arg->i == currmonidx || arg->i < 0 || arg->i >= nmons || !selection(cd))
     return;
 
   nd = &mons[arg->i].desktops[(nm = &mons[arg->i])->currdeskidx];
-  Client *c = cd->curr, *p = prevclient(c, cd), *l = prevclient(nd->head, nd);
-  /* unlink current client from current monitor's current desktop */
-  if (cd->head == c || !p)
-    cd->head = c->next;
-  else 
-    p->next = c->next;
-  c->next = NULL;
-  focus(cd->prev, cd, cm);
-  /* link to new monitor's current desktop */
-  focus(l ? (l->next = c) : nd->head ? (nd->head->next = c) : (nd->head = c), nd, nm);
+  /* unlink from current monitor's current desktop */
+  Client *curr = cd->curr, *list = unlinkmarked(cd);
+  if (cd->curr)
+    curr = list;
+  XGrabServer(dpy);
+  focus(cd->curr ? cd->curr : cd->mru, cd, cm);
+  /* link to new monitor's current desktop, the current client stays current */
+  linkclients(list, nd);
+  for (Client *c = list; c; c = c->next)
+    setclientdesktop(c, nm, nd);
+  focus(curr, nd, nm);
+  XUngrabServer(dpy);
   change_monitor(arg);
   desktopinfo(nm);
 }
@@ -369,7 +835,7 @@ void clientmessage(XEvent *e) {
   if (e->xclient.message_type == netatoms[NET_WM_STATE] &&
         ((unsigned) e->xclient.data.l[1] == netatoms[NET_FULLSCREEN]
           || (unsigned) e->xclient.data.l[2] == netatoms[NET_FULLSCREEN])) {
-    setfullscreen(c, m, (e->xclient.data.l[0] == 1 || (e->xclient.data.l[0] == 2 && !c->isfull)));
+    setfullscreen(c, d, m, (e->xclient.data.l[0] == 1 || (e->xclient.data.l[0] == 2 && !c->isfull)));
   } else if (e->xclient.message_type == netatoms[NET_ACTIVE])
       focus(c, d, m);
 }
@@ -402,10 +868,56 @@ void clientmessage(XEvent *e) {
 void configurerequest(XEvent *e) {
   XConfigureRequestEvent *ev = &e->xconfigurerequest;
   XWindowChanges wc = { ev->x, ev->y, ev->width, ev->height, ev->border_width, ev->above, ev->detail };
-  if (XConfigureWindow(dpy, ev->window, ev->value_mask, &wc))
+  Monitor *m = NULL; Desktop *d = NULL; Client *c = NULL;
+  unsigned long mask = ev->value_mask;
+  Bool w = wintoclient(ev->window, &c, &d, &m);
+  /* nothing goes over a focused fullscreen client, else a client
+   * restacking itself makes the stacking order unknown */
+  if (mask & CWStackMode && w) {
+    if (c != d->curr && d == &m->desktops[m->currdeskidx] && ISGAME(m)) {
+      mask &= ~(CWSibling | CWStackMode);
+      ngamestacks++;
+    } else
+      d->nstack = 0;
+  }
+  /* the geometry is granted as asked, so it is known without waiting for the notify */
+  if (w && (c->ishidden || (!c->isfull && !c->ismono))) {
+    if (mask & CWX) c->x = wc.x;
+    if (mask & CWY) c->y = wc.y;
+    if (mask & CWWidth) c->w = wc.width;
+    if (mask & CWHeight) c->h = wc.height;
+    c->cfgserial = NextRequest(dpy);
+  }
+  /* kept outside of the screen while hidden, showclient moves it there */
+  if (w && c->ishidden && HIDE_STRATEGY == HIDE_MOVE)
+    mask &= ~(CWX | CWY);
+  ismoved = True;
+  if (XConfigureWindow(dpy, ev->window, mask, &wc))
     XSync(dpy, False);
 }
 
+/**
+ * a client was moved or resized other than by mwm, or by mwm and the
+ * server settled it differently, then its geometry is the one it got.
+ * notifies of requests before the last geometry mwm sent are stale,
+ * and hidden, fullscreen and monocle clients keep where they go back to.
+ */
+void configurenotify(XEvent *e) {
+  XConfigureEvent *ev = &e->xconfigure;
+  Monitor *m = NULL; Desktop *d = NULL; Client *c = NULL;
+  if (ev->window == root || !wintoclient(ev->window, &c, &d, &m))
+    return;
+  if (ev->serial < c->cfgserial) {
+    nstaleconfnotifies++;
+    return;
+  }
+  if (c->ishidden || c->isfull || c->ismono)
+    return;
+  c->x = ev->x; c->y = ev->y;
+  c->w = ev->width; c->h = ev->height;
+  nconfnotifies++;
+}
+
 /**
  * clients receiving a WM_DELETE_WINDOW message should behave as if
  * the user selected "delete window" from a hypothetical menu and
@@ -425,38 +937,99 @@ void destroynotify(XEvent *e) {
   Monitor *m = NULL; Desktop *d = NULL; Client *c = NULL;
   if (wintoclient(e->xdestroywindow.window, &c, &d, &m))
     removeclient(c, d, m);
+  else
+    for (unsigned int i = 0; i < LENGTH(scratch); i++)
+      if (scratch[i].c && scratch[i].c->win == e->xdestroywindow.window)
+        freeclient(scratch[i].c);
 }
 
 /**
  * when the mouse enters a window's borders, that window,
  * if has set notifications of such events (EnterWindowMask)
  * will notify that the pointer entered its region
- * and will get focus if FOLLOW_MOUSE is set in the config.
+ * and will get focus if FOLLOW_MOUSE is set in the config,
+ * once the pointer stayed on it for FOCUS_DELAY ms.
+ *
+ * a window moved, mapped or restacked by mwm under the pointer is
+ * entered too, those crossings have a serial before crossingserial
+ * (see markcrossings) and are not a move of the mouse.
  */
 void enternotify(XEvent *e) {
   Monitor *m = NULL;
   Desktop *d = NULL;
-  Client *c = NULL, *p = NULL;
-  if (!FOLLOW_MOUSE || (e->xcrossing.mode != NotifyNormal && e->xcrossing.detail == NotifyInferior)
-      || !wintoclient(e->xcrossing.window, &c, &d, &m) || e->xcrossing.window == d->curr->win)
+  Client *c = NULL;
+  if (!cfg.followmouse || (e->xcrossing.mode != NotifyNormal && e->xcrossing.detail == NotifyInferior))
+    return;
+  if (e->xcrossing.serial < crossingserial) {
+    nowncrossings++;
+    return;
+  }
+  if (!wintoclient(e->xcrossing.window, &c, &d, &m))
     return;
+  /* back on the focused client before the delay, nothing changes */
+  if (e->xcrossing.window == d->curr->win) {
+    pointerwin = None;
+    deadlines[FOCUSTIMER] = 0;
+    return;
+  }
+  /* a client under the focused fullscreen client is not taken for a move of the mouse */
+  if (d == &m->desktops[m->currdeskidx] && ISGAME(m)) {
+    ngamecrossings++;
+    return;
+  }
 
-  if (m != &mons[currmonidx]) 
-    for (int cm = 0; cm < nmons; cm++)
-      if (m == &mons[cm]) 
-        change_monitor(&(Arg){ .i = cm });
+  nsweptcrossings += pointerwin != None;
+  pointerwin = c->win;
+  deadlines[FOCUSTIMER] = 0;
+  settimer(FOCUSTIMER, FOCUS_DELAY);
+}
+
+/**
+ * focus the client the pointer settled on, if it is
+ * still there and not under a fullscreen client
+ */
+void focuspointer(void) {
+  Monitor *m = NULL;
+  Desktop *d = NULL;
+  Client *c = NULL;
+  Window w = pointerwin;
+  pointerwin = None;
+  if (!wintoclient(w, &c, &d, &m) || d != &m->desktops[m->currdeskidx] || c == d->curr || ISGAME(m))
+    return;
 
-  if ((p = d->prev))
-    XChangeWindowAttributes(dpy, p->win, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = EnterWindowMask });
+  if (m != &mons[currmonidx])
+    change_monitor(&(Arg){ .i = m - mons });
   focus(c, d, m);
-  if (p)
-    XChangeWindowAttributes(dpy, p->win, CWEventMask, &(XSetWindowAttributes){ .event_mask = EnterWindowMask });
+}
+
+/**
+ * the crossings the requests so far cause are mwm's, the no-op
+ * makes those of the mouse from here on carry a later serial,
+ * even if nothing else is sent meanwhile
+ */
+void markcrossings(void) {
+  ismoved = False;
+  crossingserial = NextRequest(dpy);
+  XNoOp(dpy);
 }
 
 void focus(Client *c, Desktop *d, Monitor *m) {
+  Bool isshown = d == &m->desktops[m->currdeskidx];
+  if (!isshown) {
+    /* only the choice is kept, borders and grabs are redone when shown */
+    ndiscarded += d->isdirty;
+    ndeferred += (d->isdirty = d->head && c);
+  } else if (d->isdirty) {
+    d->isdirty = False;
+    napplied++;
+  }
   if (!d->head || !c) {
-    XDeleteProperty(dpy, root, netatoms[NET_ACTIVE]);
+    if (isshown)
+      XDeleteProperty(dpy, root, netatoms[NET_ACTIVE]);
+    if (isshown && m == &mons[currmonidx])
+      setfocusprio(NULL);
     d->curr = d->prev = NULL;
+    statedesktop(m, d);
     return;
   } else if (d->prev == c && d->curr != c->next)
     d->prev = prevclient((d->curr = c), d); 
@@ -464,17 +1037,38 @@ void focus(Client *c, Desktop *d, Monitor *m) {
     d->prev = d->curr; 
     d->curr = c;
   }
+  /* a cycle_win reorders the history once it ends */
+  if (!iscycling || !d->curr->mrunext)
+    mrulink(d->curr, d, True);
+  if (!isshown) {
+    statedesktop(m, d);
+    return;
+  }
   
+  Bool isgame = d->curr->isfull;
+  if (d->isunarranged && !isgame)
+    arrange(d, m, d->mode);
   for (c = d->head; c; c = c->next) {
-    XSetWindowBorder(dpy, c->win, (c != d->curr) ? win_unfocus : (m == &mons[currmonidx]) ? win_focus : win_infocus);
-    XSetWindowBorderWidth(dpy, c->win, c->isfull || c->ismono ? 0 : BORDER_WIDTH);
-    if (CLICK_TO_FOCUS || c == d->curr) 
+    /* hidden behind the fullscreen client, redone once it is not focused */
+    if (isgame && c != d->curr) {
+      ngameborders++;
+      continue;
+    }
+    XSetWindowBorder(dpy, c->win, c->ismarked ? win_mark : (c != d->curr) ? win_unfocus
+        : (m == &mons[currmonidx]) ? win_focus : win_infocus);
+    XSetWindowBorderWidth(dpy, c->win, c->isfull || c->ismono ? 0 : cfg.borderwidth);
+    if (cfg.clicktofocus || c == d->curr) 
       grabbuttons(c);
   }
   
-  XRaiseWindow(dpy, d->curr->win);
+  restack(m);
+  if (m == &mons[currmonidx])
+    setfocusprio(d->curr);
   XSetInputFocus(dpy, d->curr->win, RevertToPointerRoot, CurrentTime);
   XChangeProperty(dpy, root, netatoms[NET_ACTIVE], XA_WINDOW, 32, PropModeReplace, (unsigned char *) &d->curr->win, 1);
+  statedesktop(m, d);
+  if (nnotifyq && m == &mons[currmonidx] && !isgame)
+    notify(NULL, 0, 0);
   XSync(dpy, False);
 }
 
@@ -518,11 +1112,12 @@ void focusurgent(void) {
  * get a pixel with the requested color to
  * fill some window area (such as borders)
  */
-unsigned long getcolor(const char* color, const int screen) {
-  XColor c; Colormap map = DefaultColormap(dpy, screen);
+Bool getcolor(const char* color, unsigned long *pixel) {
+  XColor c; Colormap map = DefaultColormap(dpy, DefaultScreen(dpy));
   if (!XAllocNamedColor(dpy, map, color, &c, &c))
-    err(EXIT_FAILURE, "cannot allocate color");
-  return c.pixel;
+    return False;
+  *pixel = c.pixel;
+  return True;
 }
 
 /**
@@ -531,21 +1126,45 @@ unsigned long getcolor(const char* color, const int screen) {
  * the wm listens to those button bindings and
  * calls an appropriate handler when a binding
  * occurs (see buttonpress).
+ *
+ * the grabs of each client are remembered and only the difference
+ * is sent: buttons[] once per grabgen, FOCUS_BUTTON when it changes.
  */
 void grabbuttons(Client *c) {
   Monitor *cm = &mons[currmonidx];
-  unsigned int b, m, modifiers[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
+  Bool isfocusgrab = cfg.clicktofocus && c != cm->desktops[cm->currdeskidx].curr;
+  unsigned int b, m;
 
-  for (m = 0; CLICK_TO_FOCUS && m < LENGTH(modifiers); m++)
-    if (c != cm->desktops[cm->currdeskidx].curr) XGrabButton(dpy, FOCUS_BUTTON, modifiers[m],
+  if (c->grabgen != grabgen) {
+    if (c->grabgen)
+      XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+    c->grabgen = grabgen;
+    c->isfocusgrab = False;
+    for (b = 0; b < cfg.nbuttons; b++)
+      for (m = 0; m < nlockmods; m++)
+        XGrabButton(dpy, cfg.buttons[b].button, cfg.buttons[b].mask|lockmods[m], c->win,
+          False, BUTTONMASK, GrabModeAsync, GrabModeAsync, None, None);
+  }
+
+  for (m = 0; isfocusgrab != c->isfocusgrab && m < nlockmods; m++)
+    if (isfocusgrab) XGrabButton(dpy, FOCUS_BUTTON, lockmods[m],
         c->win, False, BUTTONMASK, GrabModeAsync, GrabModeAsync, None, None);
     else
-      XUngrabButton(dpy, FOCUS_BUTTON, modifiers[m], c->win);
+      XUngrabButton(dpy, FOCUS_BUTTON, lockmods[m], c->win);
+  c->isfocusgrab = isfocusgrab;
+}
 
-  for (b = 0, m = 0; b < LENGTH(buttons); b++, m = 0) 
-    while (m < LENGTH(modifiers))
-      XGrabButton(dpy, buttons[b].button, buttons[b].mask|modifiers[m++], c->win,
-        False, BUTTONMASK, GrabModeAsync, GrabModeAsync, None, None);
+/**
+ * the button or lock modifier grabs are stale, grab
+ * again on the clients that have or should have them
+ */
+void regrabbuttons(void) {
+  grabgen++;
+  for (int cm = 0; cm < nmons; cm++)
+    for (int cd = 0; cd < DESKTOPS; cd++)
+      for (Client *c = mons[cm].desktops[cd].head; c; c = c->next)
+        if (c->grabgen || cfg.clicktofocus || c == mons[cm].desktops[cd].curr)
+          grabbuttons(c);
 }
 
 /**
@@ -556,12 +1175,63 @@ void grabbuttons(Client *c) {
  * occurs (see keypressed).
  */
 void grabkeys(void) {
-  KeyCode code;
   XUngrabKey(dpy, AnyKey, AnyModifier, root);
-  unsigned int k, m, modifiers[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
-  for (k = 0, m = 0; k < LENGTH(keys); k++, m = 0)
-    while ((code = XKeysymToKeycode(dpy, keys[k].keysym)) && m < LENGTH(modifiers))
-      XGrabKey(dpy, code, keys[k].mod|modifiers[m++], root, True, GrabModeAsync, GrabModeAsync);
+  for (unsigned int k = 0; k < cfg.nkeys; k++)
+    grabkey(&cfg.keys[k], True);
+}
+
+/**
+ * grab or ungrab a single key binding, whatever the lock modifiers
+ */
+void grabkey(const Key *k, const Bool grab) {
+  KeyCode code = XKeysymToKeycode(dpy, k->keysym);
+  for (unsigned int m = 0; code && m < nlockmods; m++)
+    if (grab)
+      XGrabKey(dpy, code, k->mod|lockmods[m], root, True, GrabModeAsync, GrabModeAsync);
+    else
+      XUngrabKey(dpy, code, k->mod|lockmods[m], root);
+}
+
+/**
+ * find the modifier num lock is on, and the combinations of
+ * lock modifiers that every binding is grabbed with, so that
+ * it works whatever their state. there are two without num lock.
+ * the modifiers of each key are kept for keyrelease.
+ */
+void updatenumlock(void) {
+  KeyCode code = XKeysymToKeycode(dpy, XK_Num_Lock);
+  XModifierKeymap *modmap = XGetModifierMapping(dpy);
+  numlockmask = 0;
+  memset(keymods, 0, sizeof keymods);
+  for (int k = 0; k < 8; k++) 
+    for (int j = 0; j < modmap->max_keypermod; j++) {
+      KeyCode mc = modmap->modifiermap[modmap->max_keypermod*k + j];
+      keymods[mc] |= mc ? 1 << k : 0;
+      if (code && mc == code)
+        numlockmask = (1 << k);
+    }
+  XFreeModifiermap(modmap);
+
+  nlockmods = 0;
+  lockmods[nlockmods++] = 0;
+  lockmods[nlockmods++] = LockMask;
+  if (numlockmask) {
+    lockmods[nlockmods++] = numlockmask;
+    lockmods[nlockmods++] = numlockmask | LockMask;
+  }
+}
+
+/**
+ * the keyboard was remapped, keycodes and the num
+ * lock modifier may have changed, grab everything again
+ */
+void mappingnotify(XEvent *e) {
+  XRefreshKeyboardMapping(&e->xmapping);
+  if (e->xmapping.request == MappingPointer)
+    return;
+  updatenumlock();
+  grabkeys();
+  regrabbuttons();
 }
 
 /**
@@ -574,8 +1244,8 @@ void grid(int x, int y, int w, int h, const Desktop *d) {
     if (!ISIMM(c)) 
       ++n;
     if (c->ismono && !ISIMM(c)) {
-      XMoveResizeWindow(dpy, c->win, x, y, w - 2 * BORDER_WIDTH, h - 2 * BORDER_WIDTH);
-      XSetWindowBorderWidth(dpy, c->win, BORDER_WIDTH);
+      configclient(c, x, y, w - 2 * cfg.borderwidth, h - 2 * cfg.borderwidth);
+      XSetWindowBorderWidth(dpy, c->win, cfg.borderwidth);
       c->ismono = False;
     }
   }
@@ -588,7 +1258,7 @@ void grid(int x, int y, int w, int h, const Desktop *d) {
   else if (n == 5) 
     cols = 2;
 
-  int rows = n / cols, ch = h - BORDER_WIDTH, cw = (w - BORDER_WIDTH) / (cols ? cols : 1);
+  int rows = n / cols, ch = h - cfg.borderwidth, cw = (w - cfg.borderwidth) / (cols ? cols : 1);
   for (Client *c = d->head; c; c = c->next) {
     if (ISIMM(c))
       continue; 
@@ -596,8 +1266,8 @@ void grid(int x, int y, int w, int h, const Desktop *d) {
       ++i;
     if (i / rows + 1 > cols - n%cols)
       rows = n / cols + 1;
-    XMoveResizeWindow(dpy, c->win, c->x = x + cn * cw, c->y = y + rn * ch / rows, 
-      c->w = cw - BORDER_WIDTH, c->h = ch / rows - BORDER_WIDTH);
+    configclient(c, c->x = x + cn * cw, c->y = y + rn * ch / rows, 
+      c->w = cw - cfg.borderwidth, c->h = ch / rows - cfg.borderwidth);
     if (++rn >= rows) { 
       rn = 0; 
       cn++;
@@ -610,11 +1280,22 @@ void grid(int x, int y, int w, int h, const Desktop *d) {
  * call the appropriate handler
  */
 void keypress(XEvent *e) {
+  if (isswitching) {
+    switcherkey(e);
+    return;
+  } else if (isoverview) {
+    overviewkey(e);
+    return;
+  }
   KeySym keysym = XkbKeycodeToKeysym(dpy, e->xkey.keycode, 0, 0);
-  for (unsigned int i = 0; i < LENGTH(keys); i++)
-    if (keysym == keys[i].keysym && CLEANMASK(keys[i].mod) == CLEANMASK(e->xkey.state))
-      if (keys[i].func) 
-        keys[i].func(&keys[i].arg);
+  for (unsigned int i = 0; i < cfg.nkeys; i++)
+    if (keysym == cfg.keys[i].keysym && CLEANMASK(cfg.keys[i].mod) == CLEANMASK(e->xkey.state))
+      if (cfg.keys[i].func) {
+        watchkey(i, keysym);
+        keypressed = &e->xkey;
+        cfg.keys[i].func(&cfg.keys[i].arg);
+        keypressed = NULL;
+      }
 }
 
 /**
@@ -625,21 +1306,34 @@ void keypress(XEvent *e) {
 void killclient(void) {
   Monitor *m = &mons[currmonidx];
   Desktop *d = &m->desktops[m->currdeskidx];
-  if (!d->curr)
+  if (!selection(d))
     return;
 
-  Atom *prot = NULL;
-  int n = -1;
-  if (XGetWMProtocols(dpy, d->curr->win, &prot, &n))
-    while (--n >= 0 && prot[n] != wmatoms[WM_DELETE_WINDOW]);
-  if (n < 0) { 
-    XKillClient(dpy, d->curr->win);
-    removeclient(d->curr, d, m);
-  } else
-      deletewindow(d->curr->win);
-  
-  if (prot)
-    XFree(prot);
+  XGrabServer(dpy);
+  for (Client *c = d->head; c; c = c->next) {
+    if (!c->ismarked)
+      continue;
+    for (unsigned int i = 0; i < LENGTH(scratch); i++)
+      if (scratch[i].c == c)
+        scratch[i].iskilled = True;
+    Atom *prot = NULL;
+    int n = -1;
+    if (XGetWMProtocols(dpy, c->win, &prot, &n))
+      while (--n >= 0 && prot[n] != wmatoms[WM_DELETE_WINDOW]);
+    if (prot)
+      XFree(prot);
+    /* those asked to close stay until their window is gone */
+    if ((c->ismarked = n < 0))
+      XKillClient(dpy, c->win);
+    else
+      deletewindow(c->win);
+  }
+  for (Client *c = unlinkmarked(d), *t = NULL; c; c = t) {
+    t = c->next;
+    freeclient(c);
+  }
+  focus(d->curr ? d->curr : d->mru, d, m);
+  XUngrabServer(dpy);
 }
 
 void last_desktop(void) {
@@ -648,86 +1342,193 @@ void last_desktop(void) {
 
 void maprequest(XEvent *e) {
   Window w = e->xmaprequest.window;
-  XWindowAttributes wa = { 0 };
+  Hints h = { 0 };
   Monitor *m = NULL;
   Desktop *d = NULL;
   Client *c = NULL;
-  if (wintoclient(w, &c, &d, &m) || (XGetWindowAttributes(dpy, w, &wa) && wa.override_redirect))
+  if (wintoclient(w, &c, &d, &m) || (XGetWindowAttributes(dpy, w, &h.wa) && h.wa.override_redirect))
     return;
 
-  maprequest_window(m, d, c, w, &wa);
+  gethints(w, &h);
+  Scratch *s = scratchfor(&h);
+  if (s && !s->wantshow) {
+    parkscratch((s->c = addwindow(&h, NULL)), &mons[currmonidx], False);
+    s->c->isfixed = True;
+    return;
+  }
+  c = maprequest_window(&h, &d, &m);
+  if (s) {
+    (s->c = c)->isfixed = True;
+    s->wantshow = False;
+    covercenter(c, d, m);
+  }
+  focus(c, d, m);
 }
 
-void maprequest_window(Monitor *m, Desktop *d, Client *c, Window w, const XWindowAttributes *wa) {
+/**
+ * fetch everything needed to manage a window, these are all
+ * round trips, kept apart so that adopt can make them in one go
+ */
+void gethints(Window w, Hints *h) {
   XClassHint ch = { 0, 0 };
-  Bool follow = False;
-  int newmon = currmonidx, newdsk = mons[currmonidx].currdeskidx;
-  if (XGetClassHint(dpy, w, &ch))
-    for (unsigned int i = 0; i < LENGTH(rules); i++)
-      if (strstr(ch.res_class, rules[i].class) || strstr(ch.res_name, rules[i].class)) {
-        if (rules[i].monitor >= 0 && rules[i].monitor < nmons)
-          newmon = rules[i].monitor;
-        if (rules[i].desktop >= 0 && rules[i].desktop < DESKTOPS)
-          newdsk = rules[i].desktop;
-        follow = rules[i].follow;
-        break;
-      }
+  h->win = w;
+  h->class = h->inst = NULL;
+  if (XGetClassHint(dpy, w, &ch)) {
+    h->class = strintern(ch.res_class ? ch.res_class : "");
+    h->inst = strintern(ch.res_name ? ch.res_name : "");
+  }
 
   if (ch.res_class)
     XFree(ch.res_class);
   if (ch.res_name)
     XFree(ch.res_name);
 
-  c = addwindow(w, (d = &(m = &mons[newmon])->desktops[newdsk]));
-  c->istrans = XGetTransientForHint(dpy, c->win, &w);
-  c->w = wa->width;
-  c->h = wa->height;
-  
-  if (m->currdeskidx == newdsk)
-    XMapWindow(dpy, c->win);
-  if (follow) { 
-    change_monitor(&(Arg) { .i = newmon });
-    change_desktop(&(Arg) { .i = newdsk });
-  }
+  h->istrans = XGetTransientForHint(dpy, w, &w);
+  w = h->win;
 
   int i;
   unsigned long l;
   unsigned char *state = NULL;
   Atom a;
-  if (XGetWindowProperty(dpy, c->win, netatoms[NET_WM_STATE], 0L, sizeof a, False, XA_ATOM, &a, &i, &l, &l, &state) == Success && state)
-    setfullscreen(c, m, (*(Atom *) state == netatoms[NET_FULLSCREEN]));
+  h->isfull = h->isnotif = False;
+  if (XGetWindowProperty(dpy, w, netatoms[NET_WM_STATE], 0L, sizeof a, False, XA_ATOM, &a, &i, &l, &l, &state) == Success && state) {
+    h->isfull = *(Atom *) state == netatoms[NET_FULLSCREEN];
+    XFree(state);
+    state = NULL;
+  }
 
-  Bool isnotif = False;
-  if (XGetWindowProperty(dpy, c->win, netatoms[NET_WTYPE], 0L, sizeof a, False, XA_ATOM, &a, &i, &l, &l, &state) == Success && state)
+  if (XGetWindowProperty(dpy, w, netatoms[NET_WTYPE], 0L, sizeof a, False, XA_ATOM, &a, &i, &l, &l, &state) == Success && state)
     if (*(Atom *) state == netatoms[NET_NOTIF] || *(Atom *) state == netatoms[NET_UTIL])
-      isnotif = True;
+      h->isnotif = True;
 
   if (state)
     XFree(state);
 
-  coverfree(c, d, m);
-  if (isnotif)
-    covercenter(c, m);
+  const Rule *r = matchrule(h);
+  h->isfreeze = r && r->freeze;
+  h->pid = PRIORITIES || h->isfreeze ? clientpid(w) : 0;
+  h->name = getname(w);
+}
 
-  clientname(c);
-  focus(c, d, m);
+/**
+ * the process of a window as told by _NET_WM_PID, 0 if it is
+ * unknown or the window is of another host (WM_CLIENT_MACHINE)
+ */
+pid_t clientpid(Window w) {
+  static char host[HOST_NAME_MAX + 1];
+  unsigned char *p = NULL;
+  unsigned long n, after;
+  int fmt;
+  Atom type;
+  pid_t pid = 0;
+  if (XGetWindowProperty(dpy, w, netatoms[NET_PID], 0L, 1L, False, XA_CARDINAL, &type, &fmt, &n, &after, &p) == Success
+      && p && n && fmt == 32)
+    pid = *(long *) p;
+  if (p)
+    XFree(p);
+  if (pid <= 0)
+    return 0;
+
+  p = NULL;
+  if (!*host && gethostname(host, sizeof host - 1))
+    return 0;
+  if (XGetWindowProperty(dpy, w, XA_WM_CLIENT_MACHINE, 0L, sizeof host, False, XA_STRING, &type, &fmt, &n, &after, &p) == Success
+      && p && type == XA_STRING && strncmp((char *) p, host, n))
+    pid = 0;
+  if (p)
+    XFree(p);
+  return pid;
+}
+
+/**
+ * the first rule whose class is part of the class or
+ * instance name of a window, NULL if none
+ */
+const Rule *matchrule(const Hints *h) {
+  if (h->class)
+    for (unsigned int i = 0; i < cfg.nrules; i++)
+      if (strstr(h->class, cfg.rules[i].class) || strstr(h->inst, cfg.rules[i].class))
+        return &cfg.rules[i];
+  return NULL;
+}
+
+/**
+ * manage a window whose hints were fetched, without making
+ * any round trip. returns the new client, its desktop and monitor
+ * are stored in d and m, focusing it is up to the caller.
+ */
+Client *maprequest_window(const Hints *h, Desktop **d, Monitor **m) {
+  Bool follow = False;
+  int newmon = currmonidx, newdsk = mons[currmonidx].currdeskidx;
+  Client *c = NULL;
+  const Rule *r = matchrule(h);
+
+  if (r) {
+    if (r->monitor >= 0 && r->monitor < nmons)
+      newmon = r->monitor;
+    if (r->desktop >= 0 && r->desktop < DESKTOPS)
+      newdsk = r->desktop;
+    follow = r->follow;
+  }
+
+  c = addwindow(h, (*d = &(*m = &mons[newmon])->desktops[newdsk]));
+  setclientdesktop(c, *m, *d);
+  
+  if ((*m)->currdeskidx == newdsk && h->wa.map_state != IsViewable) {
+    XMapWindow(dpy, c->win);
+    ismoved = True;
+  }
+  if (follow) { 
+    change_monitor(&(Arg) { .i = newmon });
+    change_desktop(&(Arg) { .i = newdsk });
+  }
+
+  if (h->isfull)
+    setfullscreen(c, *d, *m, True);
+
+  coverfree(c, *d, *m);
+  if (h->isnotif)
+    covercenter(c, *d, *m);
+  /* placed on a desktop that is not shown, a window that is
+   * already mapped was adopted and its unmap is not a withdraw */
+  if ((*m)->currdeskidx != newdsk) {
+    Bool ismapped = h->wa.map_state == IsViewable && HIDE_STRATEGY != HIDE_MOVE;
+    if (ismapped)
+      XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = SubstructureNotifyMask });
+    hideclient(c, *m);
+    if (ismapped)
+      XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .event_mask = ROOTMASK });
+    if (HIDE_STRATEGY == HIDE_MOVE)
+      XMapWindow(dpy, c->win);
+  }
+
+  return c;
 }
 
 void mousemotion(const Arg *arg) {
   Monitor *m = &mons[currmonidx];
   Desktop *d = &m->desktops[m->currdeskidx];
-  XWindowAttributes wa;
   XEvent ev;
   Client *c = d->curr;
-  if (!c || !XGetWindowAttributes(dpy, c->win, &wa))
+  Window w;
+  unsigned int mask;
+  int rx, ry, xw, yh;
+  /* from a press on the client where the pointer was then, from a
+   * key where it is now, until a button is released */
+  if (!c || (press && press->window != c->win))
     return;
-  else if (arg->i == RESIZE)
-    XWarpPointer(dpy, c->win, c->win, 0, 0, 0, 0, --wa.width, --wa.height);
-    
-  int rx, ry, co, xw, yh;
-  unsigned int v; Window w;
-  if (!XQueryPointer(dpy, root, &w, &w, &rx, &ry, &co, &co, &v) || w != c->win)
+  else if (press)
+    rx = press->x_root, ry = press->y_root;
+  else if (!XQueryPointer(dpy, root, &w, &w, &rx, &ry, &xw, &yh, &mask))
     return;
+  Bool f = c->isfull || c->ismono;
+  int bw = f ? 0 : cfg.borderwidth, wx = f ? m->x : c->x, wy = f ? m->y : c->y;
+  int ww = f ? m->w : c->w, wh = f ? m->h : c->h;
+  if (arg->i == RESIZE) {
+    XWarpPointer(dpy, c->win, c->win, 0, 0, 0, 0, --ww, --wh);
+    rx = wx + bw + ww;
+    ry = wy + bw + wh;
+  }
 
   if (XGrabPointer(dpy, root, False, BUTTONMASK | PointerMotionMask, GrabModeAsync,
         GrabModeAsync, None, None, CurrentTime) != GrabSuccess)
@@ -736,17 +1537,19 @@ void mousemotion(const Arg *arg) {
   do {
     XMaskEvent(dpy, BUTTONMASK | PointerMotionMask | SubstructureRedirectMask, &ev);
     if (ev.type == MotionNotify) {
-      xw = (arg->i == MOVE ? wa.x : wa.width)  + ev.xmotion.x - rx;
-      yh = (arg->i == MOVE ? wa.y : wa.height) + ev.xmotion.y - ry;
+      xw = (arg->i == MOVE ? wx : ww) + ev.xmotion.x - rx;
+      yh = (arg->i == MOVE ? wy : wh) + ev.xmotion.y - ry;
       if (arg->i == RESIZE)
-        XResizeWindow(dpy, c->win, xw > MINWSZ ? (c->w = xw) : (c->w = wa.width), 
-            yh > MINWSZ ? (c->h = yh) : (c->h = wa.height));
+        configclient(c, c->x = wx, c->y = wy, c->w = xw > cfg.minwsz ? xw : ww,
+            c->h = yh > cfg.minwsz ? yh : wh);
       else if (arg->i == MOVE)
-        XMoveWindow(dpy, c->win, c->x = xw, c->y = yh);
+        configclient(c, c->x = xw, c->y = yh, c->w = ww, c->h = wh);
     } else if (ev.type == ConfigureRequest || ev.type == MapRequest)
         events[ev.type](&ev);
   } while (ev.type != ButtonRelease);
   XUngrabPointer(dpy, CurrentTime);
+  d->isspacevalid = False;
+  ismoved = True;
 }
 
 void monocle(int x, int y, int w, int h, const Desktop *d) {
@@ -754,12 +1557,12 @@ void monocle(int x, int y, int w, int h, const Desktop *d) {
   if (!c || c->istrans || c->isfull)
     return;
   else if (!c->ismono) {
-    XMoveResizeWindow(dpy, c->win, x, y, w, h);
+    configclient(c, x, y, w, h);
     XSetWindowBorderWidth(dpy, c->win, 0);
     c->ismono = True;
   } else {
-    XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
-    XSetWindowBorderWidth(dpy, c->win, BORDER_WIDTH);
+    configclient(c, c->x, c->y, c->w, c->h);
+    XSetWindowBorderWidth(dpy, c->win, cfg.borderwidth);
     c->ismono = False;
   }
 }
@@ -806,6 +1609,7 @@ void move_down(void) {
     n->next = d->curr;
   else
     d->head = d->curr;
+  statedesktop(&mons[currmonidx], d);
 }
 
 /**
@@ -851,6 +1655,7 @@ void move_up(void) {
    *  ^head         ^last           ^head         ^last
    */
   d->curr->next = d->curr->next == d->head ? NULL : p;
+  statedesktop(&mons[currmonidx], d);
 }
 
 /**
@@ -858,15 +1663,18 @@ void move_up(void) {
  */
 void moveresize(const Arg *arg) {
   Monitor *m = &mons[currmonidx]; Desktop *d = &m->desktops[m->currdeskidx];
-  XWindowAttributes wa;
   Client *c = d->curr;
-  if (!c || !XGetWindowAttributes(dpy, c->win, &wa))
+  if (!c)
     return;
   if (!c->istrans)
     focus(c, d, m); 
-  XRaiseWindow(dpy, c->win);
-  XMoveResizeWindow(dpy, c->win, c->x = wa.x + ((int *) arg->v)[0], c->y = wa.y + ((int *) arg->v)[1],
-      c->w = wa.width + ((int *) arg->v)[2], c->h = wa.height + ((int *) arg->v)[3]);
+  restack(m);
+  /* from where it is known to be, see configurenotify */
+  Bool f = c->isfull || c->ismono;
+  configclient(c, c->x = (f ? m->x : c->x) + ((int *) arg->v)[0], c->y = (f ? m->y : c->y) + ((int *) arg->v)[1],
+      c->w = (f ? m->w : c->w) + ((int *) arg->v)[2], c->h = (f ? m->h : c->h) + ((int *) arg->v)[3]);
+  d->isspacevalid = False;
+  ismoved = True;
 }
 
 void next_win(void) {
@@ -876,6 +1684,95 @@ void next_win(void) {
   listclients(d);
 }
 
+/**
+ * focus the client that was focused before the current one
+ */
+void last_win(void) {
+  Desktop *d = &mons[currmonidx].desktops[mons[currmonidx].currdeskidx];
+  if (d->curr && d->mru != d->mru->mrunext)
+    focus(d->curr == d->mru ? d->mru->mrunext : d->mru, d, &mons[currmonidx]);
+}
+
+/**
+ * step through the clients from the most to the least recently
+ * focused, or back with a negative arg->i. the history is kept as
+ * it is while the keyboard is grabbed, the release of the modifier
+ * of the binding ends the cycle and makes the client reached the
+ * most recent.
+ */
+void cycle_win(const Arg *arg) {
+  Desktop *d = &mons[currmonidx].desktops[mons[currmonidx].currdeskidx];
+  Window w;
+  int x, y;
+  unsigned int mask = 0;
+  if (!d->curr || d->mru == d->mru->mrunext)
+    return;
+  Bool isfirst = !iscycling;
+  if (isfirst) {
+    /* shift only turns the direction */
+    cyclemods = keypressed ? CLEANMASK(keypressed->state) & ~ShiftMask : 0;
+    iscycling = XGrabKeyboard(dpy, root, False, GrabModeAsync, GrabModeAsync, CurrentTime) == GrabSuccess;
+  }
+  focus(arg->i < 0 ? d->curr->mruprev : d->curr->mrunext, d, &mons[currmonidx]);
+  /* a release before the grab was not seen */
+  if (isfirst && iscycling && !(XQueryPointer(dpy, root, &w, &w, &x, &y, &x, &y, &mask) && mask & cyclemods))
+    endcycle();
+}
+
+/**
+ * the cycle ends once the modifiers of its binding are released
+ */
+void keyrelease(XEvent *e) {
+  if (iscycling && !(e->xkey.state & ~keymods[e->xkey.keycode] & cyclemods))
+    endcycle();
+}
+
+/**
+ * take the client the cycle stopped at as the most recent one
+ */
+void endcycle(void) {
+  Desktop *d = &mons[currmonidx].desktops[mons[currmonidx].currdeskidx];
+  iscycling = False;
+  XUngrabKeyboard(dpy, CurrentTime);
+  if (d->curr)
+    mrulink(d->curr, d, True);
+}
+
+/**
+ * the history of a desktop is a ring through mrunext and mruprev
+ * from d->mru, the most recently focused client, so the least recent
+ * one is d->mru->mruprev. link c first, or last if it was never
+ * focused, unlinking it first if it is in the ring already.
+ */
+void mrulink(Client *c, Desktop *d, Bool isfirst) {
+  if (d->mru == c && isfirst)
+    return;
+  mruunlink(c, d);
+  if (!d->mru)
+    c->mrunext = c->mruprev = c;
+  else {
+    c->mrunext = d->mru;
+    c->mruprev = d->mru->mruprev;
+    c->mruprev->mrunext = c->mrunext->mruprev = c;
+  }
+  if (!d->mru || isfirst)
+    d->mru = c;
+}
+
+void mruunlink(Client *c, Desktop *d) {
+  if (!c->mrunext)
+    return;
+  if (c->mrunext == c)
+    d->mru = NULL;
+  else {
+    c->mruprev->mrunext = c->mrunext;
+    c->mrunext->mruprev = c->mruprev;
+    if (d->mru == c)
+      d->mru = c->mrunext;
+  }
+  c->mrunext = c->mruprev = NULL;
+}
+
 Client *prevclient(Client *c, Desktop *d) {
   Client *p = NULL;
   if (c && d->head && d->head->next)
@@ -892,10 +1789,20 @@ void prev_win(void) {
 
 /**
  * set unrgent hint for a window
+ *
+ * title changes are only marked here, the name is fetched once
+ * NAME_DELAY ms after the first change (see updatenames), so a
+ * window rewriting its title on every frame costs a single fetch
  */
 void propertynotify(XEvent *e) {
   Monitor *m = NULL; Desktop *d = NULL; Client *c = NULL;
-  if (e->xproperty.atom != XA_WM_HINTS || !wintoclient(e->xproperty.window, &c, &d, &m))
+  if (e->xproperty.atom == XA_WM_NAME || e->xproperty.atom == netatoms[NET_WMNAME]) {
+    if (wintoclient(e->xproperty.window, &c, &d, &m) && !c->isnamedirty) {
+      c->isnamedirty = True;
+      settimer(NAMETIMER, NAME_DELAY);
+    }
+    return;
+  } else if (e->xproperty.atom != XA_WM_HINTS || !wintoclient(e->xproperty.window, &c, &d, &m))
     return;
 
   XWMHints *wmh = XGetWMHints(dpy, c->win);
@@ -903,6 +1810,7 @@ void propertynotify(XEvent *e) {
   c->isurgn = (c != cd->curr && wmh && (wmh->flags & XUrgencyHint));
   if (wmh)
     XFree(wmh);
+  stateclient(c);
 
   clientinfo(m);
 }
@@ -913,24 +1821,75 @@ void quit(const Arg *arg) {
 }
 
 void removeclient(Client *c, Desktop *d, Monitor *m) {
+  if (unlinkclient(c, d, m))
+    freeclient(c);
+}
+
+/**
+ * take a client off the list of its desktop, focusing
+ * another one if needed. returns whether it was there.
+ */
+Bool unlinkclient(Client *c, Desktop *d, Monitor *m) {
   Client **p = NULL;
   for (p = &d->head; *p && (*p != c); p = &(*p)->next);
   if (!*p) 
-    return;
+    return False;
   else 
     *p = c->next;
+  c->next = NULL;
+  d->isspacevalid = False;
+  mruunlink(c, d);
   if (c == d->prev && !(d->prev = prevclient(d->curr, d)))
     d->prev = d->head;
+  if (c == d->curr)
+    d->prev = d->mru;
   if (c == d->curr || (d->head && !d->head->next))
     focus(d->prev, d, m);
+  else
+    statedesktop(m, d);
+  return True;
+}
+
+/**
+ * forget a client whose window is gone, a scratchpad is launched
+ * again in the background unless it was killed or had only just
+ * been launched, then it waits for the scratchpad action
+ */
+void freeclient(Client *c) {
+  removeclientlist(c->win);
+  setprio(c, True);
+  for (unsigned int i = 0; i < LENGTH(scratch); i++)
+    if (scratch[i].c == c) {
+      scratch[i].c = NULL;
+      if (scratch[i].iskilled || now() - scratch[i].launched < SCRATCH_RESPAWN)
+        scratch[i].pid = 0;
+      else
+        scratch[i].pid = spawncmd(scratchpads[i].cmd), scratch[i].launched = now();
+      scratch[i].iskilled = False;
+    }
+  if (c->slot >= 0) {
+    if (state) {
+      statebegin();
+      state->clients[c->slot].win = None;
+      stateend();
+    }
+    freeslots[nfreeslots++] = c->slot;
+  } else
+    noslots--;
+  ndiscarded += c->isdirty;
+  search_del(c->search);
+  overview_untrack(c->win);
+  strrelease(c->name);
+  strrelease(c->class);
+  strrelease(c->inst);
   free(c);
 }
 
 void resize_master(const Arg *arg) {
   Monitor *m = &mons[currmonidx];
   Desktop *d = &m->desktops[m->currdeskidx];
-  int msz = (d->mode == BSTACK ? m->h : m->w) * MASTER_SIZE + (d->masz += arg->i);
-  if (msz >= MINWSZ && (d->mode == BSTACK ? m->h : m->w) - msz >= MINWSZ) 
+  int msz = (d->mode == BSTACK ? m->h : m->w) * cfg.mastersize + (d->masz += arg->i);
+  if (msz >= cfg.minwsz && (d->mode == BSTACK ? m->h : m->w) - msz >= cfg.minwsz) 
     arrange(d, m, TILE);
   else
     d->masz -= arg->i; /* reset master area size */
@@ -956,28 +1915,391 @@ void rotate_filled(const Arg *arg) {
 /**
  * main event loop
  * on receival of an event call the appropriate handler
+ *
+ * when the queue is empty wait on the connection until
+ * the next armed timer expires, then call its handler, or
+ * until SIGHUP writes to its pipe
  */
 void run(void) {
   XEvent ev;
-  while (running && !XNextEvent(dpy, &ev)) 
-    if (events[ev.type])
+  struct pollfd pfds[] = { { .fd = ConnectionNumber(dpy), .events = POLLIN }, { .fd = hupfds[0], .events = POLLIN } };
+  long long t = now(), wait;
+  char buf[16];
+  while (running) {
+    if (ishup) {
+      ishup = 0;
+      while (read(hupfds[0], buf, sizeof buf) > 0);
+      deadlines[RCTIMER] = 1; /* long expired, loadrc is called below */
+    }
+    for (int i = 0; i < TIMERS; i++)
+      if (deadlines[i] && deadlines[i] <= t) {
+        deadlines[i] = 0;
+        watch(-1, i, None);
+        timeouts[i]();
+        if (ismoved)
+          markcrossings();
+        t = unwatch(t);
+      }
+    /* the handlers may have armed any timer, also those scanned before */
+    wait = -1;
+    for (int i = 0; i < TIMERS; i++)
+      if (deadlines[i] && (wait < 0 || deadlines[i] - t < wait))
+        wait = MAX(deadlines[i] - t, 0);
+
+    if (XPending(dpy)) {
+      XNextEvent(dpy, &ev);
+      /* outputs change in bursts, the monitors are read once it settled */
+      if (rrevbase >= 0 && (ev.type == rrevbase + RRScreenChangeNotify || ev.type == rrevbase + RRNotify)) {
+        XRRUpdateConfiguration(&ev);
+        settimer(SCREENTIMER, SCREEN_DELAY);
+      }
+      if (overview_damage(&ev) || ev.type >= LASTEvent || !events[ev.type])
+        continue;
+      watch(ev.type, -1, ev.type == MapRequest ? ev.xmaprequest.window
+          : ev.type == ConfigureRequest ? ev.xconfigurerequest.window
+          : ev.type == DestroyNotify ? ev.xdestroywindow.window
+          : ev.type == UnmapNotify ? ev.xunmap.window : ev.xany.window);
       events[ev.type](&ev);
+      if (ismoved)
+        markcrossings();
+      t = unwatch(t);
+    } else {
+      poll(pfds, LENGTH(pfds), wait);
+      t = now();
+    }
+  }
 }
 
-void setfullscreen(Client *c, Monitor *m, Bool fullscrn) {
-  if (fullscrn != c->isfull)
-    XChangeProperty(dpy, c->win, netatoms[NET_WM_STATE], XA_ATOM, 32, PropModeReplace, 
-      (unsigned char *) ((c->isfull = fullscrn) ? &netatoms[NET_FULLSCREEN] : 0), fullscrn);
-  if (fullscrn)
-    XMoveResizeWindow(dpy, c->win, m->x, m->y, m->w, m->h);
-  else
-    XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+void setfullscreen(Client *c, Desktop *d, Monitor *m, Bool fullscrn) {
+  if (fullscrn != c->isfull) {
+    c->isfull = fullscrn;
+    d->isspacevalid = False;
+    setnetstate(c);
+    /* drawn straight to the screen, a game does not pay for the overview */
+    overview_redirect(c->win, !fullscrn);
+  }
+  if (placeclient(c, d, m)) {
+    XSetWindowBorderWidth(dpy, c->win, c->isfull || c->ismono ? 0 : cfg.borderwidth);
+    restack(m);
+  }
+  stateclient(c);
+  /* leaving fullscreen, what was put off meanwhile is done */
+  if (!fullscrn && c == d->curr && d == &m->desktops[m->currdeskidx])
+    focus(c, d, m);
+}
 
-  XSetWindowBorderWidth(dpy, c->win, c->isfull || c->ismono ? 0 : BORDER_WIDTH);
+/**
+ * publish the _NET_WM_STATE atoms that follow from the client flags
+ */
+void setnetstate(const Client *c) {
+  Atom atoms[2];
+  int n = 0;
+  if (c->isfull)
+    atoms[n++] = netatoms[NET_FULLSCREEN];
+  if (c->ishidden)
+    atoms[n++] = netatoms[NET_HIDDEN];
+  XChangeProperty(dpy, c->win, netatoms[NET_WM_STATE], XA_ATOM, 32, PropModeReplace, (unsigned char *) atoms, n);
+}
+
+/**
+ * take a client of a desktop that is no longer shown off the screen
+ *
+ * HIDE_UNMAP unmaps it, the cheapest for the server but the client
+ * repaints all of its contents when it is mapped again.
+ * HIDE_MOVE keeps it mapped outside of the root window, it keeps its
+ * contents and gets no unmap, but still runs as if it were visible.
+ * HIDE_ICONIC unmaps it and tells it that it is iconified, through
+ * WM_STATE and _NET_WM_STATE_HIDDEN, so it can stop drawing.
+ * unmapping callers mask the root's SubstructureNotify, the resulting
+ * UnmapNotify is not a client withdrawing its window.
+ */
+void hideclient(Client *c, const Monitor *m) {
+  c->ishidden = True;
+  ismoved = True;
+  setprio(c, False);
+  if (HIDE_STRATEGY == HIDE_MOVE) {
+    XMoveWindow(dpy, c->win, -2 * (c->isfull || c->ismono ? m->w : c->w + 2 * cfg.borderwidth), c->y);
+    return;
+  }
+  overview_unmap(c->win);
+  XUnmapWindow(dpy, c->win);
+  if (HIDE_STRATEGY == HIDE_ICONIC) {
+    XChangeProperty(dpy, c->win, wmatoms[WM_STATE], wmatoms[WM_STATE], 32, PropModeReplace,
+        (unsigned char *) (long []){ IconicState, None }, 2);
+    setnetstate(c);
+  }
+}
+
+/**
+ * bring back a client hidden by hideclient, with
+ * the geometry it was given while not shown
+ */
+void showclient(Client *c, const Monitor *m) {
+  Bool wasiconic = c->ishidden && HIDE_STRATEGY == HIDE_ICONIC;
+  c->ishidden = False;
+  ismoved = True;
+  setprio(c, False);
+  if (c->isdirty || HIDE_STRATEGY == HIDE_MOVE)
+    moveclient(c, m);
+  /* the border width follows fullscreen, which may have changed meanwhile */
+  if (c->isdirty)
+    XSetWindowBorderWidth(dpy, c->win, c->isfull || c->ismono ? 0 : cfg.borderwidth);
+  napplied += c->isdirty;
+  c->isdirty = False;
+  if (HIDE_STRATEGY == HIDE_MOVE)
+    return;
+  if (wasiconic) {
+    XChangeProperty(dpy, c->win, wmatoms[WM_STATE], wmatoms[WM_STATE], 32, PropModeReplace,
+        (unsigned char *) (long []){ NormalState, None }, 2);
+    setnetstate(c);
+  }
+  XMapWindow(dpy, c->win);
+}
+
+/**
+ * count the client in the priority class that follows from what
+ * is shown, or in none once it is gone. its process is given the
+ * priority of its most shown client by the next applyprios, and
+ * is thawed at once or frozen after FREEZE_DELAY (see freezeprocs)
+ */
+void setprio(Client *c, const Bool isgone) {
+  if (isgone && c == prioclient)
+    prioclient = NULL;
+  if (c->pid <= 0)
+    return;
+  int prio = isgone ? -1 : c->ishidden ? PRIO_HIDDEN : c == prioclient ? PRIO_FOCUS : PRIO_SHOWN;
+  if (prio == c->prio)
+    return;
+
+  Proc *p = procs;
+  while (p < procs + nprocs && p->pid != c->pid)
+    p++;
+  if (p == procs + nprocs) {
+    if (nprocs == procssz) {
+      procssz = procssz ? procssz * 2 : 16;
+      if (!(procs = realloc(procs, procssz * sizeof *procs)))
+        err(EXIT_FAILURE, "cannot allocate processes");
+      p = procs + nprocs;
+    }
+    *p = (Proc){ .pid = c->pid, .isgroup = getpgid(c->pid) == c->pid, .prio = PRIO_SHOWN };
+    nprocs++;
+  }
+  if (c->prio >= 0)
+    p->n[c->prio]--, p->nfreeze -= c->isfreeze;
+  if ((c->prio = prio) >= 0)
+    p->n[prio]++, p->nfreeze += c->isfreeze;
+  isprodirty = True;
+
+  Bool wantfrozen = p->nfreeze && !p->n[PRIO_FOCUS] && !p->n[PRIO_SHOWN];
+  if (!wantfrozen) {
+    p->freezeat = 0;
+    if (p->isfrozen)
+      freezeproc(p, False);
+  } else if (!p->isfrozen && !p->freezeat) {
+    p->freezeat = now() + FREEZE_DELAY;
+    settimer(FREEZETIMER, FREEZE_DELAY);
+  }
+}
+
+/**
+ * the client that has the input focus, on the current monitor
+ */
+void setfocusprio(Client *c) {
+  Client *p = prioclient;
+  if (c == p)
+    return;
+  prioclient = c;
+  if (p)
+    setprio(p, False);
+  if (c)
+    setprio(c, False);
+  applyprios();
+}
+
+/**
+ * renice the processes whose class changed since last applied,
+ * a process without clients anymore gets back PRIO_SHOWN. errors
+ * are ignored, the process may have exited or a nice value below
+ * the one it started with may not be allowed (see RLIMIT_NICE)
+ */
+void applyprios(void) {
+  if (!isprodirty)
+    return;
+  isprodirty = False;
+  for (int i = 0; i < nprocs; i++) {
+    Proc *p = &procs[i];
+    int prio = p->n[PRIO_FOCUS] ? PRIO_FOCUS : p->n[PRIO_HIDDEN] && !p->n[PRIO_SHOWN] ? PRIO_HIDDEN : PRIO_SHOWN;
+    if (PRIORITIES && prio != p->prio)
+      reniceproc(p, prio);
+    if (!p->n[PRIO_FOCUS] && !p->n[PRIO_SHOWN] && !p->n[PRIO_HIDDEN]) {
+      free(p->cgroup);
+      procs[i--] = procs[--nprocs];
+    }
+  }
+}
+
+/**
+ * give a process, or the process group it leads, the cpu and io
+ * priority of prio
+ */
+void reniceproc(Proc *p, const int prio) {
+  setpriority(p->isgroup ? PRIO_PGRP : PRIO_PROCESS, p->pid, priorities[prio].nice);
+  syscall(SYS_ioprio_set, p->isgroup ? IOPRIO_WHO_PGRP : IOPRIO_WHO_PROCESS, p->pid,
+      priorities[prio].ioclass << 13 | priorities[prio].iolevel);
+  p->prio = prio;
+}
+
+/**
+ * freeze the processes that were only on hidden desktops for
+ * FREEZE_DELAY, and wait again for those that are not due yet
+ */
+void freezeprocs(void) {
+  long long t = now(), next = 0;
+  for (Proc *p = procs; p < procs + nprocs; p++)
+    if (p->freezeat && p->freezeat <= t) {
+      p->freezeat = 0;
+      freezeproc(p, True);
+    } else if (p->freezeat && (!next || p->freezeat < next))
+      next = p->freezeat;
+  if (next)
+    settimer(FREEZETIMER, next - t);
+}
+
+/**
+ * stop or resume a process, by the cgroup v2 freezer if it owns
+ * its cgroup, else by signaling it or the process group it leads.
+ * a process continued by a signal runs again once this returns, a
+ * thawed cgroup once waitthaws returns. stopping may complete later
+ */
+void freezeproc(Proc *p, const Bool isfrozen) {
+  if (!p->iscgroupknown) {
+    p->iscgroupknown = True;
+    procgroup(p);
+  }
+  int fd = p->cgroup ? open(p->cgroup, O_WRONLY | O_CLOEXEC) : -1;
+  if (fd >= 0) {
+    if (write(fd, isfrozen ? "1" : "0", 1) != 1)
+      warn("cannot write %s", p->cgroup);
+    close(fd);
+    p->isthawing = !isfrozen;
+  } else if (kill(p->isgroup ? -p->pid : p->pid, isfrozen ? SIGSTOP : SIGCONT) && errno != ESRCH)
+    warn("cannot %s process %d", isfrozen ? "stop" : "continue", (int) p->pid);
+  p->isfrozen = isfrozen;
+}
+
+/**
+ * wait up to THAW_WAIT ms in all for the cgroup.events next to the
+ * cgroup.freeze of each thawed process to report it is not frozen
+ */
+void waitthaws(void) {
+  char file[PATH_MAX + 32], buf[256], *s;
+  struct timeval tv = { 0, THAW_WAIT * 1000 };
+  fd_set fds, opened;
+  for (int nfds = 1; nfds; ) {
+    nfds = 0;
+    FD_ZERO(&opened);
+    for (Proc *p = procs; p < procs + nprocs; p++) {
+      if (!p->isthawing)
+        continue;
+      snprintf(file, sizeof file, "%.*sevents", (int) (strlen(p->cgroup) - strlen("freeze")), p->cgroup);
+      int fd = open(file, O_RDONLY | O_CLOEXEC);
+      ssize_t n = fd >= 0 && fd < FD_SETSIZE ? read(fd, buf, sizeof buf - 1) : -1;
+      buf[n > 0 ? n : 0] = '\0';
+      /* reopened each round, what changes after the read is still signaled */
+      if (n > 0 && (s = strstr(buf, "frozen ")) && s[7] != '0') {
+        FD_SET(fd, &opened);
+        nfds = MAX(nfds, fd + 1);
+      } else {
+        p->isthawing = False;
+        if (fd >= 0)
+          close(fd);
+      }
+    }
+    /* a change of the file is signaled as an exceptional condition,
+     * select leaves the time that remains in tv */
+    fds = opened;
+    if (nfds && select(nfds, NULL, NULL, &fds, &tv) <= 0) {
+      for (Proc *p = procs; p < procs + nprocs; p++)
+        if (p->isthawing)
+          warnx("%s is still frozen", p->cgroup);
+      for (Proc *p = procs; p < procs + nprocs; p++)
+        p->isthawing = False;
+    }
+    for (int fd = 0; fd < nfds; fd++)
+      if (FD_ISSET(fd, &opened))
+        close(fd);
+  }
+}
+
+/**
+ * thaw the processes of the hidden clients of d, that is about to
+ * be shown, so that they draw the frame they are mapped with. the
+ * wait is outside of the server grab of change_desktop, and once
+ * for all of them
+ */
+void thawdesktop(const Desktop *d) {
+  for (Client *c = d->head; c; c = c->next)
+    for (Proc *p = procs; c->ishidden && c->pid > 0 && p < procs + nprocs; p++)
+      if (p->pid == c->pid && p->isfrozen)
+        freezeproc(p, False);
+  waitthaws();
+}
+
+/**
+ * find the cgroup.freeze of the cgroup of a process, if that cgroup
+ * holds only the process or its process group, and not mwm itself
+ */
+Bool procgroup(Proc *p) {
+  static char own[PATH_MAX];
+  char path[PATH_MAX], file[PATH_MAX + 32];
+  size_t n;
+  if ((!*own && !cgroupof(0, own, sizeof own)) || !cgroupof(p->pid, path, sizeof path))
+    return False;
+  if (!strcmp(path, "/") || (!strncmp(own, path, (n = strlen(path))) && (!own[n] || own[n] == '/')))
+    return False;
+
+  snprintf(file, sizeof file, "%s%s/cgroup.procs", CGROUP_ROOT, path);
+  FILE *f = fopen(file, "r");
+  int pid = 0;
+  Bool isowned = f != NULL;
+  while (isowned && fscanf(f, "%d", &pid) == 1)
+    isowned = pid == p->pid || (p->isgroup && getpgid(pid) == p->pid);
+  if (f)
+    fclose(f);
+  snprintf(file, sizeof file, "%s%s/cgroup.freeze", CGROUP_ROOT, path);
+  if (!isowned || access(file, W_OK) || !(p->cgroup = strdup(file)))
+    return False;
+  return True;
+}
+
+/**
+ * the cgroup v2 path of a process, of mwm if pid is 0
+ */
+Bool cgroupof(const pid_t pid, char *path, const size_t sz) {
+  char name[64], line[PATH_MAX + 8];
+  Bool found = False;
+  if (pid)
+    snprintf(name, sizeof name, "/proc/%d/cgroup", (int) pid);
+  FILE *f = fopen(pid ? name : "/proc/self/cgroup", "r");
+  if (!f)
+    return False;
+  while (!found && fgets(line, sizeof line, f))
+    if (!strncmp(line, "0::", 3)) {
+      line[strcspn(line, "\n")] = '\0';
+      /* a path cut short would name another cgroup */
+      found = (size_t) snprintf(path, sz, "%s", line + 3) < sz;
+    }
+  fclose(f);
+  return found;
 }
 
 void setup(void) {
   sigchld(0);
+  if (pipe(hupfds) < 0)
+    err(EXIT_FAILURE, "cannot create pipe");
+  for (int i = 0; i < 2; i++)
+    fcntl(hupfds[i], F_SETFL, O_NONBLOCK), fcntl(hupfds[i], F_SETFD, FD_CLOEXEC);
+  signal(SIGHUP, sighup);
   /* screen and root window */
   const int screen = DefaultScreen(dpy);
   root = RootWindow(dpy, screen);
@@ -1002,48 +2324,128 @@ void setup(void) {
 
   XFree(info);
   /* get color for focused and unfocused client borders */
-  win_focus = getcolor(FOCUS, screen);
-  win_unfocus = getcolor(UNFOCUS, screen);
-  win_infocus = getcolor(FOCUS, screen);
-  /* set numlockmask */
-  XModifierKeymap *modmap = XGetModifierMapping(dpy);
-  for (int k = 0; k < 8; k++) 
-    for (int j = 0; j < modmap->max_keypermod; j++)
-      if (modmap->modifiermap[modmap->max_keypermod*k + j] == XKeysymToKeycode(dpy, XK_Num_Lock))
-        numlockmask = (1 << k);
-  
-  XFreeModifiermap(modmap);
+  readrc(&cfg);
+  if (!getcolor(cfg.focus, &win_focus) || !getcolor(cfg.unfocus, &win_unfocus) || !getcolor(cfg.mark, &win_mark))
+    errx(EXIT_FAILURE, "cannot allocate color");
+  win_infocus = win_focus;
+  updatenumlock();
+  /* report handlers that stall the event loop */
+#ifdef BACKTRACE
+  /* the first backtrace loads libgcc, which is not done in a handler */
+  void *frame;
+  backtrace(&frame, 1);
+  mainthread = pthread_self();
+  sigaction(SIGPROF, &(struct sigaction){ .sa_handler = stacksample, .sa_flags = SA_RESTART }, NULL);
+#endif
+  pthread_t wd;
+  if (STALL_BUDGET > 0 && !pthread_create(&wd, NULL, watchdog, NULL))
+    pthread_detach(wd);
   /* set up atoms for dialog/notification windows */
   wmatoms[WM_PROTOCOLS]     = XInternAtom(dpy, "WM_PROTOCOLS",     False);
   wmatoms[WM_DELETE_WINDOW] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
+  wmatoms[WM_STATE]         = XInternAtom(dpy, "WM_STATE",         False);
   netatoms[NET_SUPPORTED]   = XInternAtom(dpy, "_NET_SUPPORTED",   False);
   netatoms[NET_WM_STATE]    = XInternAtom(dpy, "_NET_WM_STATE",    False);
   netatoms[NET_ACTIVE]      = XInternAtom(dpy, "_NET_ACTIVE_WINDOW",       False);
   netatoms[NET_FULLSCREEN]  = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
+  netatoms[NET_HIDDEN]      = XInternAtom(dpy, "_NET_WM_STATE_HIDDEN", False);
   netatoms[NET_WMNAME]      = XInternAtom(dpy, "_NET_WM_NAME", False);
   netatoms[NET_WTYPE]       = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", True);
   netatoms[NET_NOTIF]       = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_NOTIFICATION", True);
   netatoms[NET_UTIL]        = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_UTILITY", True);
+  netatoms[NET_CLIENTS]     = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+  netatoms[NET_STACKING]    = XInternAtom(dpy, "_NET_CLIENT_LIST_STACKING", False);
+  netatoms[NET_NDESKTOPS]   = XInternAtom(dpy, "_NET_NUMBER_OF_DESKTOPS", False);
+  netatoms[NET_CURRDESKTOP] = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
+  netatoms[NET_WMDESKTOP]   = XInternAtom(dpy, "_NET_WM_DESKTOP", False);
+  netatoms[NET_VIEWPORT]    = XInternAtom(dpy, "_NET_DESKTOP_VIEWPORT", False);
+  netatoms[NET_PID]         = XInternAtom(dpy, "_NET_WM_PID", False);
   /* propagate EWMH support */
   XChangeProperty(dpy, root, netatoms[NET_SUPPORTED], XA_ATOM, 32, PropModeReplace, (unsigned char *) netatoms, NET_COUNT);
   XSetErrorHandler(xerrorstart);
   /* set masks for reporting events handled by the wm */
   XSelectInput(dpy, root, ROOTMASK);
+  int rrerrbase;
+  if (XRRQueryExtension(dpy, &rrevbase, &rrerrbase))
+    XRRSelectInput(dpy, root, RRScreenChangeNotifyMask | RROutputChangeNotifyMask);
+  else
+    rrevbase = -1;
+  if (OVERVIEW)
+    overview_open(dpy, OVERVIEW_SIZE, OSD_BG, UNFOCUS, FOCUS);
   XSync(dpy, False);
   XSetErrorHandler(xerror);
   XSync(dpy, False);
   grabkeys();
+  /* client lists are appended to, drop those of a previous instance */
+  XDeleteProperty(dpy, root, netatoms[NET_CLIENTS]);
+  XDeleteProperty(dpy, root, netatoms[NET_STACKING]);
+  setdesktops();
+  setcurrentdesktop();
+  stateopen();
 
-  Window root_return, parent_return, *children;
-  unsigned int nchildren;
+  adopt();
+  for (unsigned int i = 0; i < LENGTH(scratchpads); i++)
+    if (scratchpads[i].start && !scratch[i].c)
+      scratch[i].pid = spawncmd(scratchpads[i].cmd), scratch[i].launched = now();
+}
+
+/**
+ * manage the windows that were mapped before mwm started
+ *
+ * the queries for all windows are made first, then the clients are
+ * linked with the client lists built in memory and written once, and
+ * last every desktop is focused once, instead of once per window.
+ */
+void adopt(void) {
+  Window root_return, parent_return, *children = NULL;
+  unsigned int nchildren = 0, n = 0;
+  Hints *hints = NULL;
+  long long t[4] = { now() };
   XQueryTree(dpy, root, &root_return, &parent_return, &children, &nchildren);
-  for (unsigned int i = 0; i < nchildren; i++) {
-    XWindowAttributes wa = { 0 };
-    XGetWindowAttributes(dpy, children[i], &wa);
-    if (wa.map_state == IsViewable)
-      maprequest_window(NULL, NULL, NULL, children[i], &wa);
+  if (nchildren && !(hints = calloc(nchildren, sizeof *hints)))
+    err(EXIT_FAILURE, "cannot allocate window hints");
+  for (unsigned int i = 0; i < nchildren; i++)
+    if (XGetWindowAttributes(dpy, children[i], &hints[n].wa) && !hints[n].wa.override_redirect
+        && (hints[n].wa.map_state == IsViewable || isscratchwin(children[i])))
+      gethints(children[i], &hints[n++]);
+  t[1] = now();
+
+  adopting = True;
+  for (unsigned int i = 0; i < n; i++) {
+    Desktop *d = NULL;
+    Monitor *m = NULL;
+    Scratch *s = scratchfor(&hints[i]);
+    Bool isviewable = hints[i].wa.map_state == IsViewable;
+    /* a scratchpad the previous instance hid is parked again */
+    if (s && (!isviewable || hints[i].wa.x + hints[i].wa.width <= 0)) {
+      parkscratch((s->c = addwindow(&hints[i], NULL)), &mons[currmonidx], isviewable);
+      s->c->isfixed = True;
+      continue;
+    }
+    Client *c = maprequest_window(&hints[i], &d, &m);
+    if (s)
+      (s->c = c)->isfixed = True;
+    d->prev = d->curr;
+    d->curr = c;
   }
-  
+  adopting = False;
+  XChangeProperty(dpy, root, netatoms[NET_CLIENTS], XA_WINDOW, 32, PropModeReplace, (unsigned char *) clientlist, nclientlist);
+  XChangeProperty(dpy, root, netatoms[NET_STACKING], XA_WINDOW, 32, PropModeReplace, (unsigned char *) stacklist, nclientlist);
+  t[2] = now();
+
+  /* the current monitor last, it keeps the input focus */
+  for (int cm = 0; cm < nmons; cm++) {
+    Monitor *m = &mons[(currmonidx + 1 + cm) % nmons];
+    for (int cd = 0; cd < DESKTOPS; cd++)
+      if (m->desktops[cd].head)
+        focus(m->desktops[cd].curr, &m->desktops[cd], m);
+  }
+  t[3] = now();
+
+  if (startupreport)
+    fprintf(stderr, "mwm: adopted %u of %u windows, query %lld ms, manage %lld ms, focus %lld ms\n",
+        n, nchildren, t[1] - t[0], t[2] - t[1], t[3] - t[2]);
+  free(hints);
   if (children)
     XFree(children);
 }
@@ -1056,18 +2458,26 @@ void sigchld(__attribute__((unused)) int sig) {
 }
 
 void spawn(const Arg *arg) {
-  if (fork())
-    return;
+  spawncmd(arg->cmd);
+}
+
+/**
+ * run a command in the background, returns its pid
+ */
+pid_t spawncmd(const char **cmd) {
+  pid_t pid = fork();
+  if (pid)
+    return pid;
   if (dpy) 
     close(ConnectionNumber(dpy));
   setsid();
-  execvp((char *) arg->cmd[0], (char **) arg->cmd);
-  err(EXIT_SUCCESS, "execvp %s", (char *) arg->cmd[0]);
+  execvp((char *) cmd[0], (char **) cmd);
+  err(EXIT_SUCCESS, "execvp %s", (char *) cmd[0]);
 }
 
 void stack(int x, int y, int w, int h, const Desktop *d) {
   Client *c = NULL, *t = NULL; Bool b = ( d->mode == BSTACK );
-  int n = 0, p = 0, z = (b ? w : h), ma = (b ? h : w) * MASTER_SIZE + d->masz;
+  int n = 0, p = 0, z = (b ? w : h), ma = (b ? h : w) * cfg.mastersize + d->masz;
   /* count stack windows and grab first non-floating, non-fullscreen window */
   for (t = d->head; t; t = t->next)
     if (!ISIMM(t)) { 
@@ -1077,8 +2487,8 @@ void stack(int x, int y, int w, int h, const Desktop *d) {
         c = t;
     
       if (t->ismono && !ISIMM(t)) {
-        XMoveResizeWindow(dpy, c->win, x, y, w - 2 * BORDER_WIDTH, h - 2 * BORDER_WIDTH);
-        XSetWindowBorderWidth(dpy, t->win, BORDER_WIDTH);
+        configclient(c, x, y, w - 2 * cfg.borderwidth, h - 2 * cfg.borderwidth);
+        XSetWindowBorderWidth(dpy, t->win, cfg.borderwidth);
         t->ismono = False;
       }
     }
@@ -1112,7 +2522,7 @@ void stack(int x, int y, int w, int h, const Desktop *d) {
    * and also, does not result in gaps created on the bottom of the screen.
    */
   if (c && !n)
-    XMoveResizeWindow(dpy, c->win, x, y, w - 2 * BORDER_WIDTH, h - 2 * BORDER_WIDTH);
+    configclient(c, c->x = x, c->y = y, c->w = w - 2 * cfg.borderwidth, c->h = h - 2 * cfg.borderwidth);
   if (!c || !n) 
     return;
   else if (n > 1) {
@@ -1121,25 +2531,25 @@ void stack(int x, int y, int w, int h, const Desktop *d) {
   }
   /* tile the first non-floating, non-fullscreen window to cover the master area */
   if (b)
-    XMoveResizeWindow(dpy, c->win, c->x = x, c->y = y, c->w = w - 2 * BORDER_WIDTH, c->h = ma - BORDER_WIDTH);
+    configclient(c, c->x = x, c->y = y, c->w = w - 2 * cfg.borderwidth, c->h = ma - cfg.borderwidth);
   else
-    XMoveResizeWindow(dpy, c->win, c->x = x, c->y = y, c->w = ma - BORDER_WIDTH, c->h = h - 2 * BORDER_WIDTH);
+    configclient(c, c->x = x, c->y = y, c->w = ma - cfg.borderwidth, c->h = h - 2 * cfg.borderwidth);
   /* tile the next non-floating, non-fullscreen (and first) stack window adding p */
   for (c = c->next; c && ISIMM(c); c = c->next);
-  int cw = (b ? h : w) - 2 * BORDER_WIDTH - ma, ch = z - BORDER_WIDTH;
+  int cw = (b ? h : w) - 2 * cfg.borderwidth - ma, ch = z - cfg.borderwidth;
   if (b)
-    XMoveResizeWindow(dpy, c->win, c->x = x, c->y = y += ma, c->h = ch - BORDER_WIDTH + p, c->w = cw);
+    configclient(c, c->x = x, c->y = y += ma, c->w = ch - cfg.borderwidth + p, c->h = cw);
   else
-    XMoveResizeWindow(dpy, c->win, c->x = x += ma, c->y = y, c->w = cw, c->h = ch - BORDER_WIDTH + p);
+    configclient(c, c->x = x += ma, c->y = y, c->w = cw, c->h = ch - cfg.borderwidth + p);
   /* tile the rest of the non-floating, non-fullscreen stack windows */
   for (b ? (x += ch + p) : (y += ch + p), c = c->next; c; c = c->next) {
     if (ISIMM(c))
       continue;
     if (b) { 
-      XMoveResizeWindow(dpy, c->win, c->x = x, c->y = y, c->h = ch, c->w = cw); 
+      configclient(c, c->x = x, c->y = y, c->w = ch, c->h = cw); 
       x += z;
     } else {
-      XMoveResizeWindow(dpy, c->win, c->x = x, c->y = y, c->w = cw, c->h = ch);
+      configclient(c, c->x = x, c->y = y, c->w = cw, c->h = ch);
       y += z;
     }
   }
@@ -1186,7 +2596,7 @@ Bool wintoclient(Window w, Client **c, Desktop **d, Monitor **m) {
  * thus those cases are ignored (especially on UnmapNotify's).
  */
 int xerror(__attribute__((unused)) Display *dpy, XErrorEvent *ee) {
-  if ((ee->error_code == BadAccess   && (ee->request_code == X_GrabKey
+  if (overview_iserror(ee) || (ee->error_code == BadAccess   && (ee->request_code == X_GrabKey
           ||  ee->request_code == X_GrabButton))
       || (ee->error_code  == BadMatch    && (ee->request_code == X_SetInputFocus
           ||  ee->request_code == X_ConfigureWindow))
@@ -1209,8 +2619,14 @@ int xerrorstart(__attribute__((unused)) Display *dpy, __attribute__((unused)) XE
 int main(int ARGC, char *ARGV[]) {
   if (ARGC == 2 && !strncmp(ARGV[1], "-v", 3))
     errx(EXIT_SUCCESS, "version %s", VERSION);
+  else if (ARGC == 2 && !strcmp(ARGV[1], "--startup-report"))
+    startupreport = True;
   else if (ARGC != 1) 
     errx(EXIT_FAILURE, "usage: man monsterwm");
+  if (!setlocale(LC_CTYPE, "") || !XSupportsLocale()) {
+    warnx("locale not supported by Xlib, titles are shown in the C locale");
+    setlocale(LC_CTYPE, "C");
+  }
   if (!(dpy = XOpenDisplay(NULL)))
     errx(EXIT_FAILURE, "cannot open display");
   setup();
@@ -1233,7 +2649,7 @@ void clientinfo(const Monitor *m) {
   for (Client *c = d->head; c; c = c->next) {
     unsigned urg = c->isurgn ? 2 : 1;
     if (c == d->curr)
-      NOTIFY(c->NAME, urg, 500);
+      NOTIFY(c->name, urg, 500);
   }
 }
 
@@ -1251,60 +2667,962 @@ void status(void) {
 void togglefixed(void) {
   Monitor *m = &mons[currmonidx];
   Desktop *d = &m->desktops[m->currdeskidx];
-  Client *c = d->curr;
-  c->isfixed = !c->isfixed;
+  Client *t = NULL;
+  int n = 0;
+  if (!selection(d))
+    return;
+  for (Client *c = d->head; c; c = c->next)
+    if (c->ismarked) {
+      c->isfixed = !c->isfixed;
+      c->ismarked = False;
+      stateclient((t = c));
+      n++;
+    }
+  focus(d->curr, d, m);
   char STR[1024];
-  snprintf(STR, sizeof STR - 1, "%s %s", c->NAME, c->isfixed ? "immutable" : "mutable");
+  if (n == 1)
+    snprintf(STR, sizeof STR - 1, "%s %s", t->name, t->isfixed ? "immutable" : "mutable");
+  else
+    snprintf(STR, sizeof STR - 1, "%d clients toggled", n);
   NOTIFY(STR, 1, 1000);
 }
 
-void clientname(Client *c) {
+/**
+ * mark or unmark the current client for the next bulk action,
+ * a marked client has the mark color also while focused
+ */
+void togglemark(void) {
+  Desktop *d = &mons[currmonidx].desktops[mons[currmonidx].currdeskidx];
+  if (!d->curr)
+    return;
+  d->curr->ismarked = !d->curr->ismarked;
+  XSetWindowBorder(dpy, d->curr->win, d->curr->ismarked ? win_mark : win_focus);
+}
+
+/**
+ * the clients of d that client_to_desktop, client_to_monitor,
+ * killclient and togglefixed act on, those that are marked or
+ * else the current one, which is then marked. returns whether
+ * there are any.
+ */
+Bool selection(Desktop *d) {
+  for (Client *c = d->head; c; c = c->next)
+    if (c->ismarked)
+      return True;
+  return d->curr && (d->curr->ismarked = True);
+}
+
+/**
+ * take the marked clients off d in one pass and return them
+ * linked in the order they had, unmarked. the current and previous
+ * clients of d are cleared if among them, d is refocused by the
+ * caller once it is done.
+ */
+Client *unlinkmarked(Desktop *d) {
+  Client *list = NULL, **tail = &list, **p = &d->head;
+  while (*p)
+    if ((*p)->ismarked) {
+      Client *c = *p;
+      *p = c->next;
+      c->next = NULL;
+      c->ismarked = False;
+      mruunlink(c, d);
+      if (c == d->curr)
+        d->curr = NULL;
+      if (c == d->prev)
+        d->prev = NULL;
+      *tail = c;
+      tail = &c->next;
+    } else
+      p = &(*p)->next;
+  d->isspacevalid = False;
+  return list;
+}
+
+/**
+ * append a list of clients to d, least recent in its history
+ */
+void linkclients(Client *list, Desktop *d) {
+  Client **p = &d->head;
+  for (; *p; p = &(*p)->next);
+  for (*p = list; list; list = list->next)
+    mrulink(list, d, False);
+  d->isspacevalid = False;
+}
+
+/**
+ * toggle scratchpad arg->i onto the current desktop
+ *
+ * its client waits hidden on no desktop, showing it is a configure,
+ * a map and a focus. if it is on the current desktop it is hidden
+ * again, if it is elsewhere it is brought here. a scratchpad that is
+ * not running is launched and shown once its window is mapped.
+ */
+void scratchpad(const Arg *arg) {
+  if (arg->i < 0 || arg->i >= (int) LENGTH(scratchpads))
+    return;
+  Scratch *s = &scratch[arg->i];
+  Monitor *m = &mons[currmonidx], *cm = NULL;
+  Desktop *d = &m->desktops[m->currdeskidx], *cd = NULL;
+  Client *c = NULL, *l = NULL;
+  if (!s->c) {
+    if (s->pid > 0 && !kill(s->pid, 0))
+      s->wantshow = !s->wantshow;
+    else if ((s->pid = spawncmd(scratchpads[arg->i].cmd)) > 0)
+      s->wantshow = True, s->launched = now();
+    return;
+  }
+
+  if (wintoclient(s->c->win, &c, &cd, &cm) && unlinkclient(c, cd, cm) && cd == d) {
+    parkscratch(c, m, True);
+    return;
+  }
+  c = s->c;
+  for (l = d->head; l && l->next; l = l->next);
+  *(l ? &l->next : &d->head) = c;
+  setclientdesktop(c, m, d);
+  covercenter(c, d, m);
+  showclient(c, m);
+  focus(c, d, m);
+}
+
+/**
+ * hide a scratchpad client that is on no desktop,
+ * a mapped one is unmapped without that being a withdraw
+ */
+void parkscratch(Client *c, const Monitor *m, Bool ismapped) {
+  ismapped = ismapped && !c->ishidden && HIDE_STRATEGY != HIDE_MOVE;
+  if (ismapped)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = SubstructureNotifyMask });
+  hideclient(c, m);
+  if (ismapped)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .event_mask = ROOTMASK });
+  if (HIDE_STRATEGY == HIDE_MOVE)
+    XMapWindow(dpy, c->win);
+}
+
+/**
+ * the scratchpad a window being mapped belongs to, one that
+ * was launched by mwm and whose window has not been seen yet,
+ * or while adopting, one that a previous instance launched
+ */
+Scratch *scratchfor(const Hints *h) {
+  for (unsigned int i = 0; h->class && i < LENGTH(scratchpads); i++)
+    if (!scratch[i].c && (scratch[i].pid > 0 || adopting)
+        && (!strcmp(h->class, scratchpads[i].class) || !strcmp(h->inst, scratchpads[i].class)))
+      return &scratch[i];
+  return NULL;
+}
+
+/**
+ * whether a window that is not viewable has the class of a
+ * scratchpad, which a previous instance may have parked
+ */
+Bool isscratchwin(Window w) {
+  XClassHint ch = { 0, 0 };
+  Bool found = False;
+  if (!LENGTH(scratchpads) || !XGetClassHint(dpy, w, &ch))
+    return False;
+  for (unsigned int i = 0; !found && i < LENGTH(scratchpads); i++)
+    found = (ch.res_class && !strcmp(ch.res_class, scratchpads[i].class))
+      || (ch.res_name && !strcmp(ch.res_name, scratchpads[i].class));
+  if (ch.res_class)
+    XFree(ch.res_class);
+  if (ch.res_name)
+    XFree(ch.res_name);
+  return found;
+}
+
+/**
+ * fetch the window title into the string table
+ * returns whether the title changed
+ */
+Bool clientname(Client *c) {
+  const char *old = c->name;
+  c->isnamedirty = False;
+  c->name = getname(c->win);
+  strrelease(old);
+  if (c->name != old)
+    search_set(c->search, c->name, c->class);
+  return c->name != old;
+}
+
+/**
+ * the title of a window, interned, empty if it has none
+ */
+const char *getname(Window w) {
   XTextProperty name;
-  c->NAME[0] = '\0';
-  if ((XGetTextProperty(dpy, c->win, &name, netatoms[NET_WMNAME]) ||
-        XGetTextProperty(dpy, c->win, &name, XA_WM_NAME))
+  const char *s = NULL;
+  if ((XGetTextProperty(dpy, w, &name, netatoms[NET_WMNAME]) ||
+        XGetTextProperty(dpy, w, &name, XA_WM_NAME))
       && name.nitems) {
     char **list = NULL;
     int n;
     if (name.encoding == XA_STRING)
-      strncpy(c->NAME, (char *) name.value, sizeof c->NAME - 1);
+      s = strintern((char *) name.value);
     else if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
-			strncpy(c->NAME, *list, sizeof c->NAME - 1);
-			XFreeStringList(list);
-		}
+      s = strintern(*list);
+      XFreeStringList(list);
+    }
 
-    c->NAME[sizeof c->NAME - 1] = '\0';
     XFree(name.value);
   }
+
+  return s ? s : strintern("");
 }
 
-void coverfree(Client *c, Desktop *d, Monitor *m) {
-  int x = 0, y = 0, minh = 0, ww = c->w, wh = c->h;
-  if (d->head->next) {
-    Client *c = d->head;
-    for (; c->next->next; c = c->next)
-      minh = !minh || c->h < minh ? c->h : minh;
-
-    x = c->w + c->x;
-    if (x + ww > m->w) {
-      x = 0;
-      y = !minh || c->h < minh ? c->h : minh;
+/**
+ * refresh the titles that changed since the name timer was armed
+ */
+void updatenames(void) {
+  for (int cm = 0; cm < nmons; cm++)
+    for (int cd = 0; cd < DESKTOPS; cd++)
+      for (Client *c = mons[cm].desktops[cd].head; c; c = c->next)
+        if (c->isnamedirty)
+          clientname(c);
+}
+
+long long now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * arm a timer to expire in ms milliseconds,
+ * unless it is already armed
+ */
+void settimer(const int t, const int ms) {
+  if (!deadlines[t])
+    deadlines[t] = now() + ms;
+}
+
+/**
+ * mark the start of a handler, for the watchdog
+ * and for unwatch to measure it
+ */
+void watch(const int type, const int key, const Window win) {
+  watched = (Stall){ 0, type, key, win, NoSymbol };
+  __atomic_add_fetch(&dispatches, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * add the key binding to the watched KeyPress handler
+ */
+void watchkey(const int key, const KeySym keysym) {
+  __atomic_add_fetch(&dispatches, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  watched.key = key;
+  watched.keysym = keysym;
+  __atomic_add_fetch(&dispatches, 1, __ATOMIC_RELEASE);
+}
+
+void printstall(const char *prefix, const Stall *s) {
+  if (s->type < 0)
+    fprintf(stderr, "mwm: %stimer %d: %lld ms\n", prefix, s->key, s->ms);
+  else if (s->key >= 0)
+    fprintf(stderr, "mwm: %s%s on 0x%lx, key %d (keysym 0x%lx): %lld ms\n", prefix,
+        evnames[s->type], s->win, s->key, s->keysym, s->ms);
+  else
+    fprintf(stderr, "mwm: %s%s on 0x%lx: %lld ms\n", prefix,
+        evnames[s->type] ? evnames[s->type] : "event", s->win, s->ms);
+}
+
+/**
+ * mark the end of the watched handler, that started at start,
+ * log and keep it if it ran over budget. returns the time.
+ */
+long long unwatch(const long long start) {
+  long long t = now();
+  __atomic_add_fetch(&dispatches, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  if (STALL_BUDGET > 0 && t - start > STALL_BUDGET) {
+    watched.ms = t - start;
+    stalls[nstalls++ % STALL_RING] = watched;
+    printstall("slow ", &watched);
+  }
+  return t;
+}
+
+/**
+ * watchdog thread, wakes every STALL_BUDGET ms and reports a handler
+ * that was already running at the previous wake up, while it runs.
+ * it reads no clock, so it does not disturb a recorded trace.
+ */
+void *watchdog(__attribute__((unused)) void *arg) {
+  struct timespec ts = { STALL_BUDGET / 1000, STALL_BUDGET % 1000 * 1000000L };
+  unsigned long seen = 0, reported = 0;
+  for (;;) {
+    nanosleep(&ts, NULL);
+    unsigned long d = __atomic_load_n(&dispatches, __ATOMIC_ACQUIRE);
+    if (d & 1 && d == seen && d != reported) {
+      Stall s = watched;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      /* the handler ended while it was copied, it was not a stall */
+      if (__atomic_load_n(&dispatches, __ATOMIC_RELAXED) == d) {
+        s.ms = STALL_BUDGET;
+        printstall("stalled over budget in ", &s);
+#ifdef BACKTRACE
+        pthread_kill(mainthread, SIGPROF);
+#endif
+        reported = d;
+      }
     }
-    
-    y += c->y;
-    if (y + wh > m->h)
-      x = y = 0;
+    seen = d;
+  }
+  return NULL;
+}
+
+#ifdef BACKTRACE
+/**
+ * sample the stack of the stalled main thread, backtrace
+ * was called once in setup so that it is safe here
+ */
+void stacksample(__attribute__((unused)) int sig) {
+  void *frames[32];
+  backtrace_symbols_fd(frames, backtrace(frames, LENGTH(frames)), STDERR_FILENO);
+}
+#endif
+
+/**
+ * print the recent slow handlers, oldest first
+ */
+void dumpstalls(void) {
+  unsigned int i = nstalls > STALL_RING ? nstalls - STALL_RING : 0;
+  fprintf(stderr, "mwm: %u slow handlers, last %u:\n", nstalls, nstalls - i);
+  for (; i < nstalls; i++)
+    printstall("", &stalls[i % STALL_RING]);
+  fprintf(stderr, "mwm: %u passes deferred for hidden desktops, %u applied, %u discarded\n",
+      ndeferred, napplied, ndiscarded);
+  fprintf(stderr, "mwm: while fullscreen, %u arranges deferred, %u notifications held, %u dropped, "
+      "%u borders skipped, %u crossings and %u restack requests ignored\n",
+      ngamearranges, ngamenotifies, ngamedropped, ngameborders, ngamecrossings, ngamestacks);
+  fprintf(stderr, "mwm: %u crossings caused by mwm ignored, %u passed over before the pointer settled\n",
+      nowncrossings, nsweptcrossings);
+  fprintf(stderr, "mwm: %u configure notifies taken, %u stale ignored\n",
+      nconfnotifies, nstaleconfnotifies);
+}
+
+/**
+ * send a notification, unless a fullscreen client is focused on
+ * the current monitor, then it is held until it is not. NULL sends
+ * those held.
+ */
+void notify(const char *body, const unsigned char urg, const unsigned int to) {
+  if (body && running && ISGAME(&mons[currmonidx])) {
+    if (nnotifyq == NOTIFY_HOLD) {
+      memmove(notifyq, notifyq + 1, --nnotifyq * sizeof *notifyq);
+      ngamedropped++;
+    }
+    snprintf(notifyq[nnotifyq].body, sizeof notifyq->body, "%s", body);
+    notifyq[nnotifyq].urg = urg;
+    notifyq[nnotifyq++].to = to;
+    ngamenotifies++;
+    return;
+  }
+  /* the on-screen display shows only the last one anyway */
+  for (unsigned int i = 0; i < nnotifyq; i++)
+    if (!cfg.notifyosd || !osd || (!body && i == nnotifyq - 1))
+      sendnotify(notifyq[i].body, notifyq[i].urg, notifyq[i].to);
+  nnotifyq = 0;
+  if (body)
+    sendnotify(body, urg, to);
+}
+
+/**
+ * show a notification on screen, if notify_osd is set and the font
+ * could be loaded, else send it over D-Bus if built with it (DBUS)
+ */
+void sendnotify(const char *body, const unsigned char urg, const unsigned int to) {
+  if (cfg.notifyosd && running && (osd < 0 ? (osd = osd_open(dpy, OSD_FONT, OSD_FG, OSD_BG, FOCUS)) : osd)) {
+    Monitor *m = &mons[currmonidx];
+    osd_show(body, urg, m->x, m->y, m->w);
+    deadlines[OSDTIMER] = 0;
+    settimer(OSDTIMER, to);
+    return;
+  }
+#ifdef DBUS
+  notify_send("mwm", body, urg, to);
+#endif
+}
+
+/**
+ * create the state page, see mwmstate.h
+ *
+ * every update is a write section of the seqlock, readers retry
+ * a copy that overlapped one. the page is updated per monitor,
+ * per desktop or per client, by whoever changed that part.
+ */
+void stateopen(void) {
+  char name[256];
+  const char *display = getenv("DISPLAY");
+  snprintf(name, sizeof name, "%s%s", MWMSTATE_NAME, display ? display : "");
+  for (nfreeslots = 0; nfreeslots < MWMSTATE_CLIENTS; nfreeslots++)
+    freeslots[nfreeslots] = MWMSTATE_CLIENTS - 1 - nfreeslots;
+
+  int fd = -1;
+  if (!SHM_STATE || (fd = shm_open(name, O_RDWR | O_CREAT, 0600)) < 0
+      || ftruncate(fd, sizeof *state) < 0
+      || (state = mmap(NULL, sizeof *state, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    if (SHM_STATE)
+      warn("cannot publish state page %s", name);
+    state = NULL;
+  }
+  if (fd >= 0)
+    close(fd);
+  if (!state)
+    return;
+
+  /* a previous instance may have died inside a write */
+  state->seq |= 1;
+  __sync_synchronize();
+  memset(state->mons, 0, sizeof state->mons);
+  memset(state->clients, 0, sizeof state->clients);
+  state->version = MWMSTATE_VERSION;
+  state->pid = getpid();
+  state->nmons = nmons;
+  state->ndesktops = DESKTOPS;
+  state->currmon = currmonidx;
+  state->overflow = 0;
+  for (int i = 0; i < MWMSTATE_CLIENTS; i++)
+    state->clients[i].next = MWMSTATE_NONE;
+  for (int m = 0; m < MWMSTATE_MONS; m++)
+    for (int d = 0; d < MWMSTATE_DESKTOPS; d++)
+      state->desktops[m][d] = (MwmStateDesktop){ 0, 0, MWMSTATE_NONE, MWMSTATE_NONE };
+  stateend();
+  for (int m = 0; m < nmons; m++)
+    statemonitor(&mons[m]);
+  state->magic = MWMSTATE_MAGIC;
+}
+
+void stateclose(void) {
+  char name[256];
+  const char *display = getenv("DISPLAY");
+  if (!state)
+    return;
+  statebegin();
+  state->pid = 0;
+  stateend();
+  munmap(state, sizeof *state);
+  state = NULL;
+  snprintf(name, sizeof name, "%s%s", MWMSTATE_NAME, display ? display : "");
+  shm_unlink(name);
+}
+
+void statebegin(void) {
+  state->seq++;
+  __sync_synchronize();
+}
+
+void stateend(void) {
+  __sync_synchronize();
+  state->seq++;
+}
+
+void statemonitor(const Monitor *m) {
+  int i = m - mons;
+  if (!state || i >= MWMSTATE_MONS)
+    return;
+  statebegin();
+  state->mons[i] = (MwmStateMonitor){ m->x, m->y, m->w, m->h, m->currdeskidx, m->prevdeskidx };
+  state->currmon = currmonidx;
+  stateend();
+}
+
+uint32_t clientflags(const Client *c) {
+  return (c->isurgn ? MWMSTATE_URGENT : 0) | (c->isfull ? MWMSTATE_FULLSCREEN : 0)
+    | (c->isfixed ? MWMSTATE_FIXED : 0) | (c->istrans ? MWMSTATE_TRANSIENT : 0)
+    | (c->ismono ? MWMSTATE_MONOCLE : 0);
+}
+
+/**
+ * rewrite the desktop and the links of its clients,
+ * clients without a slot are left out of the list
+ */
+void statedesktop(const Monitor *m, const Desktop *d) {
+  int mi = m - mons, di = d - m->desktops, n = 0, *link = NULL;
+  if (!state || mi >= MWMSTATE_MONS || di >= MWMSTATE_DESKTOPS)
+    return;
+
+  MwmStateDesktop *sd = &state->desktops[mi][di];
+  statebegin();
+  state->overflow = noslots;
+  sd->mode = d->mode;
+  sd->curr = d->curr ? d->curr->slot : MWMSTATE_NONE;
+  link = &sd->head;
+  for (Client *c = d->head; c; c = c->next, n++) {
+    if (c->slot < 0)
+      continue;
+    MwmStateClient *sc = &state->clients[c->slot];
+    *sc = (MwmStateClient){ c->win, mi, di, MWMSTATE_NONE, clientflags(c) };
+    *link = c->slot;
+    link = &sc->next;
+  }
+  *link = MWMSTATE_NONE;
+  sd->nclients = n;
+  stateend();
+}
+
+void stateclient(const Client *c) {
+  if (!state || c->slot < 0)
+    return;
+  statebegin();
+  state->clients[c->slot].flags = clientflags(c);
+  stateend();
+}
+
+/**
+ * ewmh client lists are kept in memory so that a new window
+ * only appends to the root properties, whereas unmanaging or
+ * restacking rewrites them, but only when the order changed
+ */
+void addclientlist(Window w) {
+  if (nclientlist == clientlistsz) {
+    clientlistsz = clientlistsz ? clientlistsz * 2 : 32;
+    if (!(clientlist = realloc(clientlist, clientlistsz * sizeof(Window)))
+        || !(stacklist = realloc(stacklist, clientlistsz * sizeof(Window))))
+      err(EXIT_FAILURE, "cannot allocate client list");
+  }
+
+  clientlist[nclientlist] = stacklist[nclientlist] = w;
+  nclientlist++;
+  if (adopting)
+    return;
+  XChangeProperty(dpy, root, netatoms[NET_CLIENTS], XA_WINDOW, 32, PropModeAppend, (unsigned char *) &w, 1);
+  XChangeProperty(dpy, root, netatoms[NET_STACKING], XA_WINDOW, 32, PropModeAppend, (unsigned char *) &w, 1);
+}
+
+void removeclientlist(Window w) {
+  int i = 0, j = 0;
+  for (; i < nclientlist && clientlist[i] != w; i++);
+  for (; j < nclientlist && stacklist[j] != w; j++);
+  if (i == nclientlist || j == nclientlist)
+    return;
+
+  memmove(&clientlist[i], &clientlist[i + 1], (nclientlist - i - 1) * sizeof(Window));
+  memmove(&stacklist[j], &stacklist[j + 1], (nclientlist - j - 1) * sizeof(Window));
+  nclientlist--;
+  XChangeProperty(dpy, root, netatoms[NET_CLIENTS], XA_WINDOW, 32, PropModeReplace, (unsigned char *) clientlist, nclientlist);
+  XChangeProperty(dpy, root, netatoms[NET_STACKING], XA_WINDOW, 32, PropModeReplace, (unsigned char *) stacklist, nclientlist);
+}
+
+/**
+ * move the windows, given top first, to the top of the stacking list
+ */
+void raiseclientlist(const Window *w, int n) {
+  int i = 0;
+  for (; i < n && i < nclientlist && stacklist[nclientlist - 1 - i] == w[i]; i++);
+  if (i == n)
+    return;
+
+  while (n--) {
+    for (i = nclientlist - 1; i >= 0 && stacklist[i] != w[n]; i--);
+    if (i < 0 || i == nclientlist - 1)
+      continue;
+    memmove(&stacklist[i], &stacklist[i + 1], (nclientlist - i - 1) * sizeof(Window));
+    stacklist[nclientlist - 1] = w[n];
+  }
+  XChangeProperty(dpy, root, netatoms[NET_STACKING], XA_WINDOW, 32, PropModeReplace, (unsigned char *) stacklist, nclientlist);
+}
+
+/**
+ * stack the clients of the shown desktop of m, fullscreen clients over
+ * floating and transient ones over tiled ones. within a layer the
+ * current client is on top, new clients under it, then the rest in the
+ * order last sent. the order is sent only when it differs from that,
+ * raising the top client over other windows only when it changed.
+ * the order is kept per desktop, showing a desktop maps its clients
+ * in that order, so switching back needs no restacking.
+ */
+void restack(Monitor *m) {
+  Desktop *d = &m->desktops[m->currdeskidx];
+  int n = 0, k = 0;
+  for (Client *c = d->head; c; c = c->next)
+    n++;
+  if (!n)
+    return;
+
+  Client *cs[n];
+  int rank[n];
+  Window order[n];
+  for (Client *c = d->head; c; c = c->next, k++) {
+    int i = 0, r = c == d->curr ? 0 : 1;
+    for (; r && i < d->nstack && d->stack[i] != c->win; i++);
+    if (r && i < d->nstack)
+      r = i + 2;
+    /* insertion sort by layer, then rank, n is small */
+    for (i = k; i > 0 && (LAYER(cs[i - 1]) > LAYER(c) || (LAYER(cs[i - 1]) == LAYER(c) && rank[i - 1] > r)); i--) {
+      cs[i] = cs[i - 1];
+      rank[i] = rank[i - 1];
+    }
+    cs[i] = c;
+    rank[i] = r;
+  }
+  for (k = 0; k < n; k++)
+    order[k] = cs[k]->win;
+  if (n == d->nstack && !memcmp(order, d->stack, n * sizeof(Window)))
+    return;
+
+  /* the common case is one client moving to the top, which is one raise,
+   * clients that left the desktop meanwhile do not matter */
+  Window rest[n];
+  int nrest = 0;
+  for (int i = 0; i < d->nstack; i++)
+    for (k = 1; k < n; k++)
+      if (order[k] == d->stack[i])
+        rest[nrest++] = order[k];
+  Bool israise = nrest == n - 1 && !memcmp(rest, order + 1, nrest * sizeof(Window));
+  Window *stack = realloc(d->stack, n * sizeof(Window));
+  if (!stack)
+    return;
+  if (!d->nstack || stack[0] != order[0])
+    XRaiseWindow(dpy, order[0]);
+  if (!israise)
+    XRestackWindows(dpy, order, n);
+  memcpy((d->stack = stack), order, n * sizeof(Window));
+  d->nstack = n;
+  ismoved = True;
+  raiseclientlist(order, n);
+}
+
+/**
+ * each monitor contributes DESKTOPS desktops to the ewmh desktop
+ * numbering, desktop d of monitor m is number m * DESKTOPS + d
+ */
+void setclientdesktop(Client *c, const Monitor *m, const Desktop *d) {
+  long desktop = (m - mons) * DESKTOPS + (d - m->desktops);
+  if (c->desktop == desktop)
+    return;
+  c->desktop = desktop;
+  XChangeProperty(dpy, c->win, netatoms[NET_WMDESKTOP], XA_CARDINAL, 32, PropModeReplace, (unsigned char *) &desktop, 1);
+}
+
+void setcurrentdesktop(void) {
+  long desktop = currmonidx * DESKTOPS + mons[currmonidx].currdeskidx;
+  if (currdesktop == desktop)
+    return;
+  currdesktop = desktop;
+  XChangeProperty(dpy, root, netatoms[NET_CURRDESKTOP], XA_CARDINAL, 32, PropModeReplace, (unsigned char *) &desktop, 1);
+}
+
+/**
+ * the viewport of a desktop is the origin of its monitor
+ */
+void setdesktops(void) {
+  long n = nmons * DESKTOPS, *viewport = NULL;
+  if (!(viewport = calloc(2 * n, sizeof(long))))
+    err(EXIT_FAILURE, "cannot allocate viewports");
+  for (int i = 0; i < n; i++) {
+    viewport[2 * i] = mons[i / DESKTOPS].x;
+    viewport[2 * i + 1] = mons[i / DESKTOPS].y;
+  }
+
+  XChangeProperty(dpy, root, netatoms[NET_NDESKTOPS], XA_CARDINAL, 32, PropModeReplace, (unsigned char *) &n, 1);
+  XChangeProperty(dpy, root, netatoms[NET_VIEWPORT], XA_CARDINAL, 32, PropModeReplace, (unsigned char *) viewport, 2 * n);
+  free(viewport);
+}
+
+/**
+ * read the monitors again after a RandR change and diff them with the
+ * current ones. a monitor stays with the new one at its origin, or else
+ * with the first new one left, and keeps its desktops. the desktops of
+ * monitors that are gone are joined to those of the current monitor.
+ * only the monitors that moved or were resized and the desktops that
+ * were joined are laid out again, the shown ones now, others once shown.
+ */
+void updatemons(void) {
+  int n = 0, to = -1, oldn = nmons;
+  XineramaScreenInfo *info = XineramaQueryScreens(dpy, &n);
+  if (!n || !info) {
+    if (info)
+      XFree(info);
+    return;
+  }
+
+  int from[n]; /* the monitor each new one continues, -1 if added */
+  Bool isused[oldn], ischanged = n != oldn;
+  for (int j = 0; j < oldn; j++)
+    isused[j] = False;
+  for (int i = 0; i < n; i++) {
+    from[i] = -1;
+    for (int j = 0; j < oldn && from[i] < 0; j++)
+      if (!isused[j] && mons[j].x == info[i].x_org && mons[j].y == info[i].y_org)
+        isused[(from[i] = j)] = True;
+  }
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < oldn && from[i] < 0; j++)
+      if (!isused[j])
+        isused[(from[i] = j)] = True;
+  for (int i = 0; i < n && !ischanged; i++)
+    ischanged = from[i] != i || mons[i].x != info[i].x_org || mons[i].y != info[i].y_org
+      || mons[i].w != info[i].width || mons[i].h != info[i].height;
+  if (!ischanged) {
+    XFree(info);
+    return;
+  }
+
+  Monitor *old = mons;
+  if (!(mons = calloc(n, sizeof(Monitor))))
+    err(EXIT_FAILURE, "cannot allocate mons");
+  for (int i = 0; i < n; i++) {
+    if (from[i] >= 0)
+      mons[i] = old[from[i]];
+    else
+      mons[i] = (Monitor){ .x = info[i].x_org, .y = info[i].y_org, .w = info[i].width, .h = info[i].height };
+    if (from[i] == currmonidx)
+      to = i;
+  }
+  nmons = n;
+  currmonidx = to = to < 0 ? 0 : to;
+
+  /* nothing is drawn in between, clients see one transition */
+  Bool isjoined[n][DESKTOPS], ismoved[n];
+  memset(isjoined, 0, sizeof isjoined);
+  XGrabServer(dpy);
+  if (HIDE_STRATEGY != HIDE_MOVE)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .do_not_propagate_mask = SubstructureNotifyMask });
+  for (int j = 0; j < oldn; j++)
+    for (int k = 0; k < DESKTOPS && !isused[j]; k++) {
+      isjoined[to][k] |= old[j].desktops[k].head != NULL;
+      joindesktop(&old[j].desktops[k], &old[j], &mons[to].desktops[k], &mons[to]);
+    }
+  if (HIDE_STRATEGY != HIDE_MOVE)
+    XChangeWindowAttributes(dpy, root, CWEventMask, &(XSetWindowAttributes){ .event_mask = ROOTMASK });
+  free(old);
+
+  for (int i = 0; i < n; i++) {
+    int dx = info[i].x_org - mons[i].x, dy = info[i].y_org - mons[i].y;
+    ismoved[i] = dx || dy || mons[i].w != info[i].width || mons[i].h != info[i].height;
+    mons[i].x = info[i].x_org;
+    mons[i].y = info[i].y_org;
+    mons[i].w = info[i].width;
+    mons[i].h = info[i].height;
+    for (int k = 0; k < DESKTOPS; k++) {
+      Desktop *d = &mons[i].desktops[k];
+      if (ismoved[i] || isjoined[i][k])
+        relayout(d, &mons[i], dx, dy);
+      for (Client *c = d->head; c; c = c->next)
+        setclientdesktop(c, &mons[i], d);
+      statedesktop(&mons[i], d);
+    }
+    statemonitor(&mons[i]);
+  }
+  XFree(info);
+  if (state) {
+    statebegin();
+    state->nmons = nmons;
+    stateend();
+  }
+  /* borders and stacking of the shown desktops that changed, the current one last */
+  for (int i = 0; i < nmons; i++) {
+    Desktop *d = &mons[i].desktops[mons[i].currdeskidx];
+    if (i != currmonidx && (ismoved[i] || isjoined[i][mons[i].currdeskidx]))
+      focus(d->curr, d, &mons[i]);
+  }
+  Desktop *d = &mons[currmonidx].desktops[mons[currmonidx].currdeskidx];
+  focus(d->curr, d, &mons[currmonidx]);
+  XUngrabServer(dpy);
+  setdesktops();
+  setcurrentdesktop();
+  desktopinfo(&mons[currmonidx]);
+}
+
+/**
+ * move the clients of a desktop of a monitor that is gone to the end
+ * of a desktop of another monitor, keeping their focus history and
+ * their place relative to the monitor
+ */
+void joindesktop(Desktop *d, const Monitor *m, Desktop *n, const Monitor *nm) {
+  Bool wasshown = d == &m->desktops[m->currdeskidx], isshown = n == &nm->desktops[nm->currdeskidx];
+  Client **t = &n->head;
+  for (; *t; t = &(*t)->next);
+  for (Client *c = (*t = d->head); c; c = c->next) {
+    c->x += nm->x - m->x;
+    c->y += nm->y - m->y;
+    if (wasshown && !isshown)
+      hideclient(c, nm);
+    else if (!wasshown && isshown)
+      showclient(c, nm);
+  }
+  while (d->mru) {
+    Client *c = d->mru;
+    mruunlink(c, d);
+    mrulink(c, n, False);
+  }
+  if (!n->curr)
+    n->curr = d->curr;
+  n->nstack = 0;
+  n->isspacevalid = False;
+  free(d->stack);
+  free(d->space);
+}
+
+/**
+ * lay out a desktop again once its monitor moved by dx, dy or was
+ * resized. clients the layout does not place are moved along and
+ * kept inside the monitor. a monocle desktop is not arranged, which
+ * would toggle it, so all of its clients are placed that way
+ */
+void relayout(Desktop *d, Monitor *m, const int dx, const int dy) {
+  Bool isshown = d == &m->desktops[m->currdeskidx];
+  if (!d->head)
+    return;
+  d->isspacevalid = False;
+  for (Client *c = d->head; c; c = c->next) {
+    c->x = MAX(m->x, MIN(c->x + dx, m->x + m->w - c->w - 2 * cfg.borderwidth));
+    c->y = MAX(m->y, MIN(c->y + dy, m->y + m->h - c->h - 2 * cfg.borderwidth));
+    if (d->mode == MONOCLE || ISIMM(c) || c->isfull || c->ismono)
+      placeclient(c, d, m);
+  }
+  if (d->mode == MONOCLE)
+    return;
+  if (isshown)
+    arrange(d, m, d->mode);
+  else
+    d->isunarranged = True;
+}
+
+/**
+ * place a new client at the highest, then leftmost, area
+ * of the monitor that is free of the other clients
+ */
+void coverfree(Client *c, Desktop *d, Monitor *m) {
+  int x = 0, y = 0, ww = c->w + 2 * cfg.borderwidth, wh = c->h + 2 * cfg.borderwidth;
+  if (!d->isspacevalid)
+    spacebuild(d, m, c);
+  if (!spacefit(d, ww, wh, &x, &y))
+    x = y = 0;
+  if (!c->isfull && !c->ismono)
+    spaceuse(d, (Rect){ x, y, ww, wh });
+
+  c->x = m->x + x;
+  c->y = m->y + y;
+  placeclient(c, d, m);
+}
+
+void covercenter(Client *c, Desktop *d, Monitor *m) {
+  c->x = m->x + m->w / 2 - c->w / 2;
+  c->y = m->y + m->h / 2 - c->h / 2;
+  d->isspacevalid = False;
+  placeclient(c, d, m);
+}
+
+/**
+ * the free space of a desktop is kept as the maximal rectangles not
+ * covered by its clients. placing a client takes its area out of them,
+ * anything else that moves or removes clients drops them, they are
+ * then built again from the clients, but for the one being placed.
+ */
+void spacebuild(Desktop *d, const Monitor *m, const Client *skip) {
+  if (d->spacesz < 1 && !(d->space = realloc(d->space, (d->spacesz = 16) * sizeof(Rect))))
+    err(EXIT_FAILURE, "cannot allocate free space");
+  d->space[0] = (Rect){ 0, 0, m->w, m->h };
+  d->nspace = 1;
+  d->isspacevalid = True;
+  for (Client *c = d->head; c; c = c->next)
+    if (c != skip && !c->isfull && !c->ismono)
+      spaceuse(d, (Rect){ c->x - m->x, c->y - m->y, c->w + 2 * cfg.borderwidth, c->h + 2 * cfg.borderwidth });
+}
+
+/**
+ * take area a out of the free space, each rectangle it
+ * overlaps leaves up to four around it, those that end up
+ * inside another one are not maximal and are dropped
+ */
+void spaceuse(Desktop *d, Rect a) {
+  int n = d->nspace, k = 0;
+  for (int i = 0; i < n; i++)
+    k += a.x < d->space[i].x + d->space[i].w && d->space[i].x < a.x + a.w
+      && a.y < d->space[i].y + d->space[i].h && d->space[i].y < a.y + a.h;
+  if (!k)
+    return;
+  if (n + 4 * k > d->spacesz && !(d->space = realloc(d->space, (d->spacesz = 2 * (n + 4 * k)) * sizeof(Rect))))
+    err(EXIT_FAILURE, "cannot allocate free space");
+
+  Rect *r = d->space;
+  for (int i = 0; i < n; i++) {
+    Rect f = r[i];
+    if (a.x >= f.x + f.w || f.x >= a.x + a.w || a.y >= f.y + f.h || f.y >= a.y + a.h)
+      continue;
+    if (a.x > f.x)
+      r[d->nspace++] = (Rect){ f.x, f.y, a.x - f.x, f.h };
+    if (a.x + a.w < f.x + f.w)
+      r[d->nspace++] = (Rect){ a.x + a.w, f.y, f.x + f.w - a.x - a.w, f.h };
+    if (a.y > f.y)
+      r[d->nspace++] = (Rect){ f.x, f.y, f.w, a.y - f.y };
+    if (a.y + a.h < f.y + f.h)
+      r[d->nspace++] = (Rect){ f.x, a.y + a.h, f.w, f.y + f.h - a.y - a.h };
+    r[i].w = 0;
+  }
+
+  /* of equal rectangles the first is kept */
+  Bool iscovered[d->nspace];
+  for (int i = 0; i < d->nspace; i++) {
+    iscovered[i] = !r[i].w;
+    for (int j = 0; j < d->nspace && !iscovered[i]; j++)
+      iscovered[i] = j != i && r[j].w && r[j].x <= r[i].x && r[j].y <= r[i].y
+        && r[j].x + r[j].w >= r[i].x + r[i].w && r[j].y + r[j].h >= r[i].y + r[i].h
+        && (j < i || r[j].x != r[i].x || r[j].y != r[i].y || r[j].w != r[i].w || r[j].h != r[i].h);
+  }
+  n = 0;
+  for (int i = 0; i < d->nspace; i++)
+    if (!iscovered[i])
+      r[n++] = r[i];
+  d->nspace = n;
+}
+
+/**
+ * the highest, then leftmost, position where a w by h area
+ * is free, returns whether there is one
+ */
+Bool spacefit(const Desktop *d, int w, int h, int *x, int *y) {
+  const Rect *best = NULL;
+  for (int i = 0; i < d->nspace; i++)
+    if (d->space[i].w >= w && d->space[i].h >= h && (!best || d->space[i].y < best->y
+          || (d->space[i].y == best->y && d->space[i].x < best->x)))
+      best = &d->space[i];
+  if (best) {
+    *x = best->x;
+    *y = best->y;
+  }
+  return best != NULL;
+}
+
+/**
+ * send the geometry of a client, unless its desktop is not shown,
+ * then it is sent once by showclient, before the client is mapped,
+ * together with its border width. returns whether it was sent.
+ */
+Bool placeclient(Client *c, const Desktop *d, const Monitor *m) {
+  if (d == &m->desktops[m->currdeskidx]) {
+    moveclient(c, m);
+    return True;
   }
+  ndiscarded += c->isdirty;
+  ndeferred++;
+  c->isdirty = True;
+  return False;
+}
 
-  c->x = x;
-  c->y = y;
-  XMoveWindow(dpy, c->win, c->x, c->y);
+/**
+ * fullscreen and monocle clients cover the monitor,
+ * the rest are where the layout or the user put them
+ */
+void moveclient(Client *c, const Monitor *m) {
+  ismoved = True;
+  if (c->isfull || c->ismono)
+    configclient(c, m->x, m->y, m->w, m->h);
+  else
+    configclient(c, c->x, c->y, c->w, c->h);
 }
 
-void covercenter(Client *c, Monitor *m) {
-  c->x = m->w / 2 - c->w / 2;
-  c->y = m->h / 2 - c->h / 2;
-  XMoveWindow(dpy, c->win, c->x, c->y);
+/**
+ * send the geometry of a client, the ConfigureNotify of
+ * any request before this one no longer tells where it is
+ */
+void configclient(Client *c, int x, int y, int w, int h) {
+  c->cfgserial = NextRequest(dpy);
+  XMoveResizeWindow(dpy, c->win, x, y, w, h);
 }
 
 void setlayout(const Arg *arg) {
@@ -1315,7 +3633,16 @@ void setlayout(const Arg *arg) {
 
 void arrange(Desktop *d, Monitor *m, const int mode) {
   d->mode = mode;
+  d->isspacevalid = False;
+  /* nothing of it would be seen, it is done once the fullscreen client is not focused */
+  if ((d->isunarranged = d == &m->desktops[m->currdeskidx] && ISGAME(m))) {
+    ngamearranges++;
+    statedesktop(m, d);
+    return;
+  }
   layout[mode](m->x, m->y, m->w, m->h, d);
+  ismoved = True;
+  statedesktop(m, d);
 }
 
 void setfloating(void)
@@ -1323,24 +3650,30 @@ void setfloating(void)
   Desktop *d = &mons[currmonidx].desktops[mons[currmonidx].currdeskidx];
   Client *c = d->curr;
   if (c && !c->istrans) {
-    XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
-    XSetWindowBorderWidth(dpy, c->win, BORDER_WIDTH);
+    configclient(c, c->x, c->y, c->w, c->h);
+    XSetWindowBorderWidth(dpy, c->win, cfg.borderwidth);
+    ismoved = True;
     c->ismono = False;
   }
 }
 
+/**
+ * the lines that do not fit are left out
+ */
 void listclients(Desktop *d) {
   char STR[1024] = { 0 };
+  size_t len = 0;
   unsigned n = 1;
   for (Client *c = d->head; c; c = c->next, n++) {
-    char C[128];
-    if (c->isfixed)
-      snprintf(C, sizeof C - 1, "%d: %c[%s]\n", n, c == d->curr ? '*' : ' ', c->NAME);
-    else
-      snprintf(C, sizeof C - 1, "%d: %c%s\n", n, c == d->curr ? '*' : ' ', c->NAME);
-    strcat(STR, C);
+    int l = snprintf(STR + len, sizeof STR - len, c->isfixed ? "%d: %c[%s]\n" : "%d: %c%s\n",
+        n, c == d->curr ? '*' : ' ', c->name);
+    if (l < 0 || (size_t) l >= sizeof STR - len) {
+      STR[len] = '\0';
+      break;
+    }
+    len += l;
   }
-  
+
   NOTIFY(STR, 1, 500);
 }
 
@@ -1355,3 +3688,416 @@ void to_client(const Arg *arg) {
     listclients(d);
   }
 }
+
+/**
+ * search the clients of all monitors and desktops by title and class
+ *
+ * the keyboard is grabbed until a client is chosen with Return or
+ * Escape is pressed. typed text narrows the list, Up, Down and Tab
+ * move the choice, which is shown as the notifications are.
+ */
+void switcher(void) {
+  if (iscycling || isswitching)
+    return;
+  if (XGrabKeyboard(dpy, root, False, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess)
+    return;
+  isswitching = True;
+  switchquery[0] = '\0';
+  switchsel = 0;
+  showswitcher();
+}
+
+void switcherkey(XEvent *e) {
+  KeySym keysym = XkbKeycodeToKeysym(dpy, e->xkey.keycode, 0, e->xkey.state & ShiftMask ? 1 : 0);
+  size_t n = strlen(switchquery);
+  if (keysym == XK_Escape || keysym == XK_Return || keysym == XK_KP_Enter) {
+    const void **found = NULL;
+    int nfound = search_query(switchquery, &found);
+    endswitcher();
+    if (keysym != XK_Escape && switchsel < nfound)
+      jumpto((Client *) found[switchsel]);
+    return;
+  } else if (keysym == XK_BackSpace && n)
+    switchquery[n - 1] = '\0';
+  else if (keysym == XK_Down || keysym == XK_Tab)
+    switchsel++;
+  else if (keysym == XK_Up || keysym == XK_ISO_Left_Tab)
+    switchsel--;
+  else if (keysym >= XK_space && keysym <= XK_asciitilde && n < sizeof switchquery - 1) {
+    switchquery[n] = keysym;
+    switchquery[n + 1] = '\0';
+    switchsel = 0;
+  } else
+    return;
+  showswitcher();
+}
+
+/**
+ * leave the switcher, on a choice or SWITCH_TIMEOUT after the last key
+ */
+void endswitcher(void) {
+  isswitching = False;
+  deadlines[SWITCHTIMER] = 0;
+  XUngrabKeyboard(dpy, CurrentTime);
+  if (osd > 0)
+    osd_hide();
+}
+
+/**
+ * the query and the page of SWITCH_LINES matches with the choice,
+ * marked as the current client is by listclients. the lines that
+ * do not fit are left out
+ */
+void showswitcher(void) {
+  const void **found = NULL;
+  int nfound = search_query(switchquery, &found);
+  char STR[1024];
+  size_t len = snprintf(STR, sizeof STR, "> %s", switchquery);
+  switchsel = nfound ? (switchsel % nfound + nfound) % nfound : 0;
+  for (int i = switchsel - switchsel % SWITCH_LINES; i < nfound && i < switchsel - switchsel % SWITCH_LINES + SWITCH_LINES
+      && len < sizeof STR; i++) {
+    const Client *c = found[i];
+    int l = snprintf(STR + len, sizeof STR - len, "\n%c%s [%s]", i == switchsel ? '*' : ' ',
+        c->name, c->class ? c->class : "");
+    if (l < 0 || (size_t) l >= sizeof STR - len) {
+      STR[len] = '\0';
+      break;
+    }
+    len += l;
+  }
+  char count[32];
+  if (nfound > SWITCH_LINES && len + snprintf(count, sizeof count, "\n  (%d/%d)", switchsel + 1, nfound) < sizeof STR)
+    strcat(STR, count);
+  /* asked for, so not held behind a fullscreen client */
+  sendnotify(STR, 1, SWITCH_TIMEOUT);
+  deadlines[SWITCHTIMER] = 0;
+  settimer(SWITCHTIMER, SWITCH_TIMEOUT);
+}
+
+/**
+ * show thumbnails of the clients of all desktops of the current
+ * monitor, by desktop, with the focused one chosen
+ *
+ * the keyboard is grabbed until a client is chosen with Return or
+ * Escape is pressed, the arrows and Tab move the choice
+ */
+void overview(void) {
+  Monitor *m = &mons[currmonidx];
+  if (iscycling || isswitching || isoverview)
+    return;
+  noverviewwins = overviewsel = 0;
+  for (int cd = 0; cd < DESKTOPS; cd++)
+    for (Client *c = m->desktops[cd].head; c; c = c->next) {
+      if (noverviewwins == overviewwinssz) {
+        overviewwinssz = overviewwinssz ? overviewwinssz * 2 : 32;
+        if (!(overviewwins = realloc(overviewwins, overviewwinssz * sizeof *overviewwins)))
+          err(EXIT_FAILURE, "cannot allocate overview");
+      }
+      if (c == m->desktops[m->currdeskidx].curr)
+        overviewsel = noverviewwins;
+      overviewwins[noverviewwins++] = c->win;
+    }
+  if (!(overviewcols = overview_show(overviewwins, noverviewwins, overviewsel, m->x, m->y, m->w, m->h)))
+    return;
+  if (XGrabKeyboard(dpy, root, False, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess)
+    overview_hide();
+  else
+    isoverview = True;
+}
+
+void overviewkey(XEvent *e) {
+  KeySym keysym = XkbKeycodeToKeysym(dpy, e->xkey.keycode, 0, 0);
+  int sel = overviewsel;
+  if (keysym == XK_Escape || keysym == XK_Return || keysym == XK_KP_Enter) {
+    Monitor *m = NULL; Desktop *d = NULL; Client *c = NULL;
+    isoverview = False;
+    XUngrabKeyboard(dpy, CurrentTime);
+    overview_hide();
+    /* the client may be gone since */
+    if (keysym != XK_Escape && wintoclient(overviewwins[overviewsel], &c, &d, &m))
+      jumpto(c);
+    return;
+  } else if (keysym == XK_Left)
+    sel--;
+  else if (keysym == XK_Right || keysym == XK_Tab)
+    sel++;
+  else if (keysym == XK_Up)
+    sel -= overviewcols;
+  else if (keysym == XK_Down)
+    sel += overviewcols;
+  if (sel >= 0 && sel < noverviewwins && sel != overviewsel)
+    overview_select((overviewsel = sel));
+}
+
+/**
+ * focus c, on whichever monitor and desktop it is, or bring
+ * it here if it is a scratchpad that is hidden
+ */
+void jumpto(Client *c) {
+  Monitor *m = NULL; Desktop *d = NULL; Client *f = NULL;
+  if (!wintoclient(c->win, &f, &d, &m)) {
+    for (unsigned int i = 0; i < LENGTH(scratch); i++)
+      if (scratch[i].c == c)
+        scratchpad(&(Arg){ .i = i });
+    return;
+  }
+  change_monitor(&(Arg){ .i = m - mons });
+  change_desktop(&(Arg){ .i = d - m->desktops + 1 });
+  focus(c, d, m);
+}
+
+/**
+ * reload RCFILE, deferred to a timer as the action may
+ * run from a loop over the tables that are replaced
+ */
+void reload(void) {
+  settimer(RCTIMER, 0);
+}
+
+/**
+ * ask run() to reload RCFILE, the pipe wakes it if it is in poll
+ * or about to be
+ */
+void sighup(__attribute__((unused)) int sig) {
+  int e = errno;
+  ishup = 1;
+  /* a full pipe wakes run() as well */
+  while (write(hupfds[1], "", 1) < 0 && errno == EINTR);
+  errno = e;
+}
+
+/**
+ * read RCFILE over the config.h defaults
+ *
+ * key, button and rule lines replace the compiled in table of their
+ * kind as a whole, set lines change single settings. a bad line is
+ * reported and skipped, a missing file leaves the defaults.
+ */
+void readrc(Config *c) {
+  const char *dir = getenv("XDG_CONFIG_HOME"), *home = getenv("HOME");
+  Rc rc = { .cfg = c };
+  *c = defcfg;
+  if (dir && *dir)
+    snprintf(rcpath, sizeof rcpath, "%s/%s", dir, RCFILE);
+  else
+    snprintf(rcpath, sizeof rcpath, "%s/.config/%s", home ? home : "", RCFILE);
+  if (rcread(rcpath, rcline, &rc) < 0)
+    return;
+  if (rc.nkeys) {
+    c->keys = rcown(c, rc.keys);
+    c->nkeys = rc.nkeys;
+  }
+  if (rc.nbuttons) {
+    c->buttons = rcown(c, rc.buttons);
+    c->nbuttons = rc.nbuttons;
+  }
+  if (rc.nrules) {
+    c->rules = rcown(c, rc.rules);
+    c->nrules = rc.nrules;
+  }
+}
+
+/**
+ * parse one line of RCFILE:
+ *   set <setting> <value>
+ *   key <modifiers> <keysym> <action> [argument...]
+ *   button <modifiers> <button> <action> [argument]
+ *   rule <class> <monitor> <desktop> <follow> [<freeze>]
+ * modifiers are joined by +, eg Mod4+Shift
+ */
+void rcline(int argc, char *argv[], int line, void *arg) {
+  Rc *rc = arg;
+  Config *c = rc->cfg;
+  const char *error = NULL;
+  unsigned int i = 0, mod = 0;
+  int n = 0;
+  Arg a;
+  if (!strcmp(argv[0], "set") && argc == 3) {
+    char *end = NULL;
+    float f = strtof(argv[2], &end);
+    for (; i < LENGTH(setnames) && strcmp(argv[1], setnames[i].name); i++);
+    void *field = i < LENGTH(setnames) ? (char *) c + setnames[i].offset : NULL;
+    if (!field)
+      error = "unknown setting";
+    else if (setnames[i].type == SET_FLOAT && (*end || end == argv[2]))
+      error = "not a number";
+    else if (setnames[i].type == SET_INT && !rcint(argv[2], &n))
+      error = "not a number";
+    else if (setnames[i].type == SET_FLOAT)
+      *(float *) field = f;
+    else if (setnames[i].type == SET_INT)
+      *(int *) field = n;
+    else if (setnames[i].type == SET_BOOL)
+      *(Bool *) field = !strcmp(argv[2], "true") || !strcmp(argv[2], "1");
+    else
+      *(const char **) field = rcown(c, strdup(argv[2]));
+  } else if ((!strcmp(argv[0], "key") || !strcmp(argv[0], "button")) && argc >= 4) {
+    Bool iskey = argv[0][0] == 'k';
+    KeySym sym = iskey ? XStringToKeysym(argv[2]) : NoSymbol;
+    for (; i < LENGTH(actions) && strcmp(argv[3], actions[i].name); i++);
+    if (!rcmods(argv[1], &mod))
+      error = "unknown modifier";
+    else if (iskey ? sym == NoSymbol : !rcint(argv[2], &n) || n < Button1 || n > Button5)
+      error = iskey ? "unknown keysym" : "unknown button";
+    else if (i == LENGTH(actions))
+      error = "unknown action";
+    else if (!rcarg(actions[i].arg, argc - 4, argv + 4, c, &a))
+      error = "bad argument";
+    else if (iskey) {
+      if (!(rc->keys = realloc(rc->keys, (rc->nkeys + 1) * sizeof(Key))))
+        err(EXIT_FAILURE, "cannot allocate keys");
+      memcpy(&rc->keys[rc->nkeys++], &(Key){ mod, sym, actions[i].func, a }, sizeof(Key));
+    } else {
+      if (!(rc->buttons = realloc(rc->buttons, (rc->nbuttons + 1) * sizeof(Button))))
+        err(EXIT_FAILURE, "cannot allocate buttons");
+      memcpy(&rc->buttons[rc->nbuttons++], &(Button){ mod, n, actions[i].func, a }, sizeof(Button));
+    }
+  } else if (!strcmp(argv[0], "rule") && (argc == 5 || argc == 6)) {
+    int mon, desk;
+    if (!rcint(argv[2], &mon) || !rcint(argv[3], &desk))
+      error = "not a number";
+    else {
+      if (!(rc->rules = realloc(rc->rules, (rc->nrules + 1) * sizeof(Rule))))
+        err(EXIT_FAILURE, "cannot allocate rules");
+      memcpy(&rc->rules[rc->nrules++], &(Rule){ rcown(c, strdup(argv[1])), mon, desk,
+          !strcmp(argv[4], "true") || !strcmp(argv[4], "1"),
+          argc == 6 && (!strcmp(argv[5], "true") || !strcmp(argv[5], "1")) }, sizeof(Rule));
+    }
+  } else
+    error = "unknown line";
+
+  if (error)
+    fprintf(stderr, "mwm: %s:%d: %s\n", rcpath, line, error);
+}
+
+/**
+ * the argument of an action, from the words after its name
+ */
+Bool rcarg(const int kind, int argc, char *argv[], Config *c, Arg *a) {
+  int v[4] = { 0 };
+  if (kind == ARG_NONE && !argc)
+    memcpy(a, &(Arg){ NULL }, sizeof *a);
+  else if (kind == ARG_INT && argc == 1 && rcint(argv[0], v))
+    memcpy(a, &(Arg){ .i = v[0] }, sizeof *a);
+  else if (kind == ARG_MOVE && argc == 4 && rcint(argv[0], &v[0]) && rcint(argv[1], &v[1])
+      && rcint(argv[2], &v[2]) && rcint(argv[3], &v[3]))
+    memcpy(a, &(Arg){ .v = memcpy(rcown(c, malloc(sizeof v)), v, sizeof v) }, sizeof *a);
+  else if (kind == ARG_CMD && argc) {
+    const char **cmd = rcown(c, calloc(argc + 1, sizeof *cmd));
+    for (int i = 0; i < argc; i++)
+      cmd[i] = rcown(c, strdup(argv[i]));
+    memcpy(a, &(Arg){ .cmd = cmd }, sizeof *a);
+  } else
+    return False;
+  return True;
+}
+
+/**
+ * a number, or one of the names of argnames
+ */
+Bool rcint(const char *s, int *i) {
+  char *end;
+  for (unsigned int n = 0; n < LENGTH(argnames); n++)
+    if (!strcmp(s, argnames[n].name))
+      return *i = argnames[n].i, True;
+  *i = strtol(s, &end, 10);
+  return *s && !*end;
+}
+
+Bool rcmods(char *s, unsigned int *mod) {
+  for (char *m = strtok(s, "+"); m; m = strtok(NULL, "+")) {
+    unsigned int n = 0;
+    for (; n < LENGTH(modnames) && strcmp(m, modnames[n].name); n++);
+    if (n == LENGTH(modnames))
+      return False;
+    *mod |= modnames[n].mask;
+  }
+  return True;
+}
+
+/**
+ * take ownership of memory that lives as long as the config
+ */
+void *rcown(Config *c, void *p) {
+  if (!p || !(c->allocs = realloc(c->allocs, (c->nallocs + 1) * sizeof(void *))))
+    err(EXIT_FAILURE, "cannot allocate config");
+  return c->allocs[c->nallocs++] = p;
+}
+
+void freeconfig(Config *c) {
+  for (unsigned int i = 0; i < c->nallocs; i++)
+    free(c->allocs[i]);
+  free(c->allocs);
+}
+
+/**
+ * read RCFILE again and apply only what differs from the config
+ * in use: keys are grabbed and ungrabbed one by one, buttons are
+ * grabbed again only if they changed and borders are set only
+ * on the shown windows whose color or width is another.
+ */
+void loadrc(void) {
+  long long t = now();
+  Config o = cfg;
+  unsigned int i, j, grabbed = 0, ungrabbed = 0;
+  readrc(&cfg);
+
+  for (i = 0; i < o.nkeys; i++) {
+    for (j = 0; j < cfg.nkeys && (cfg.keys[j].keysym != o.keys[i].keysym || cfg.keys[j].mod != o.keys[i].mod); j++);
+    if (j == cfg.nkeys && ++ungrabbed)
+      grabkey(&o.keys[i], False);
+  }
+  for (i = 0; i < cfg.nkeys; i++) {
+    for (j = 0; j < o.nkeys && (o.keys[j].keysym != cfg.keys[i].keysym || o.keys[j].mod != cfg.keys[i].mod); j++);
+    if (j == o.nkeys && ++grabbed)
+      grabkey(&cfg.keys[i], True);
+  }
+
+  Bool buttons = o.nbuttons != cfg.nbuttons || o.clicktofocus != cfg.clicktofocus;
+  for (i = 0; !buttons && i < cfg.nbuttons; i++)
+    buttons = o.buttons[i].button != cfg.buttons[i].button || o.buttons[i].mask != cfg.buttons[i].mask;
+
+  unsigned long focus = win_focus, unfocus = win_unfocus, mark = win_mark;
+  if (strcmp(o.focus, cfg.focus) && !getcolor(cfg.focus, &focus))
+    fprintf(stderr, "mwm: %s: cannot allocate color %s\n", rcpath, cfg.focus);
+  if (strcmp(o.unfocus, cfg.unfocus) && !getcolor(cfg.unfocus, &unfocus))
+    fprintf(stderr, "mwm: %s: cannot allocate color %s\n", rcpath, cfg.unfocus);
+  if (strcmp(o.mark, cfg.mark) && !getcolor(cfg.mark, &mark))
+    fprintf(stderr, "mwm: %s: cannot allocate color %s\n", rcpath, cfg.mark);
+
+  Bool relayout = o.borderwidth != cfg.borderwidth || o.mastersize != cfg.mastersize;
+  for (int cm = 0; cm < nmons; cm++)
+    for (int cd = 0; cd < DESKTOPS; cd++) {
+      Monitor *m = &mons[cm];
+      Desktop *d = &m->desktops[cd];
+      Bool isshown = cd == m->currdeskidx;
+      for (Client *c = d->head; c; c = c->next) {
+        if (o.followmouse != cfg.followmouse)
+          XSelectInput(dpy, c->win, CLIENTMASK);
+        /* hidden desktops get their borders when shown */
+        if (!isshown)
+          continue;
+        unsigned long border = c->ismarked ? mark : c == d->curr ? focus : unfocus;
+        if (border != (c->ismarked ? win_mark : c == d->curr ? win_focus : win_unfocus))
+          XSetWindowBorder(dpy, c->win, border);
+        if (o.borderwidth != cfg.borderwidth && !c->isfull && !c->ismono)
+          XSetWindowBorderWidth(dpy, c->win, cfg.borderwidth);
+      }
+      /* tiles follow the new sizes, those of hidden desktops once shown */
+      if (!relayout || !d->head || d->mode == MONOCLE)
+        continue;
+      else if (isshown)
+        arrange(d, m, d->mode);
+      else
+        d->isunarranged = True;
+    }
+
+  if (buttons)
+    regrabbuttons();
+  win_infocus = win_focus = focus;
+  win_unfocus = unfocus;
+  win_mark = mark;
+  freeconfig(&o);
+  fprintf(stderr, "mwm: loaded %s in %lld ms, %u keys grabbed, %u ungrabbed%s\n",
+      rcpath, now() - t, grabbed, ungrabbed, buttons ? ", buttons grabbed again" : "");
+}
@@ -0,0 +1,66 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <time.h>
+#include "mwmstate.h"
+
+/**
+ * example consumer of the mwm state page
+ *
+ * prints one line per monitor, with its desktops, the number of
+ * clients on them, the focused window and urgency, e.g.
+ *   *0: 1:[3] 2:1 3:0! 4:0  0x1a00003
+ * with -f it prints a new line whenever the state changes,
+ * polling the sequence number, which is a plain memory read,
+ * until mwm exits.
+ */
+
+static void print(const MwmState *s) {
+  for (int m = 0; m < s->nmons && m < MWMSTATE_MONS; m++) {
+    const MwmStateMonitor *mon = &s->mons[m];
+    const MwmStateDesktop *curr = &s->desktops[m][mon->currdesk];
+    printf("%s%d:", m == s->currmon ? "*" : "", m);
+    for (int d = 0; d < s->ndesktops && d < MWMSTATE_DESKTOPS; d++) {
+      int urgent = 0;
+      for (int c = s->desktops[m][d].head; c != MWMSTATE_NONE; c = s->clients[c].next)
+        urgent |= s->clients[c].flags & MWMSTATE_URGENT;
+      printf(d == mon->currdesk ? " %d:[%d]" : " %d:%d", d + 1, s->desktops[m][d].nclients);
+      if (urgent)
+        putchar('!');
+    }
+    if (curr->curr != MWMSTATE_NONE)
+      printf("  0x%lx", (unsigned long) s->clients[curr->curr].win);
+    putchar('\n');
+  }
+  fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+  int follow = argc == 2 && !strcmp(argv[1], "-f");
+  const MwmState *s = mwmstate_open(NULL);
+  MwmState *copy = malloc(sizeof *copy);
+  if (!s)
+    errx(EXIT_FAILURE, "mwm is not running");
+  if (!copy)
+    err(EXIT_FAILURE, "cannot allocate state");
+
+  if (mwmstate_read(s, copy) < 0)
+    errx(EXIT_FAILURE, "mwm is gone");
+  print(copy);
+  /* a crashed mwm does not clear pid */
+  while (follow && copy->pid && mwmstate_alive(s)) {
+    nanosleep(&(struct timespec){ 0, 50000000 }, NULL);
+    if (!mwmstate_changed(s, copy->seq))
+      continue;
+    if (mwmstate_read(s, copy) < 0)
+      break;
+    print(copy);
+  }
+
+  mwmstate_close(s);
+  free(copy);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "mwmstate.h"
+
+#define MWMSTATE_SPINS 1000 /* tries before waiting on a write */
+
+/**
+ * reader side of the mwm state page
+ *
+ * opening maps the page read-only, after that reading
+ * is a copy under the seqlock and costs no system call.
+ */
+
+const MwmState *mwmstate_open(const char *display) {
+  char name[256];
+  const MwmState *s = NULL;
+  if (!display && !(display = getenv("DISPLAY")))
+    display = "";
+  snprintf(name, sizeof name, "%s%s", MWMSTATE_NAME, display);
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  s = mmap(NULL, sizeof *s, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (s == MAP_FAILED)
+    return NULL;
+  if (s->magic != MWMSTATE_MAGIC || s->version != MWMSTATE_VERSION) {
+    munmap((void *) s, sizeof *s);
+    return NULL;
+  }
+  return s;
+}
+
+void mwmstate_close(const MwmState *s) {
+  if (s)
+    munmap((void *) s, sizeof *s);
+}
+
+/**
+ * copy a consistent snapshot of the page into copy, its seq is the
+ * sequence number it corresponds to. returns 0, or -1 if mwm is gone
+ * and left a write unfinished. a write takes microseconds, after
+ * MWMSTATE_SPINS tries the reader sleeps between tries and checks
+ * that mwm is still there.
+ */
+int mwmstate_read(const MwmState *s, MwmState *copy) {
+  uint32_t seq;
+  for (unsigned int n = 1; ; n++) {
+    if (!((seq = s->seq) & 1)) {
+      __sync_synchronize();
+      memcpy(copy, (const void *) s, sizeof *copy);
+      __sync_synchronize();
+      if (s->seq == seq)
+        break;
+    }
+    if (n % MWMSTATE_SPINS)
+      continue;
+    if (!mwmstate_alive(s))
+      return -1;
+    nanosleep(&(struct timespec){ 0, 1000000 }, NULL);
+  }
+  copy->seq = seq;
+  return 0;
+}
+
+/**
+ * whether the mwm that writes the page is still running
+ */
+int mwmstate_alive(const MwmState *s) {
+  pid_t pid = s->pid;
+  return pid > 0 && (!kill(pid, 0) || errno == EPERM);
+}
+
+/**
+ * whether the page changed since the snapshot of sequence seq
+ */
+int mwmstate_changed(const MwmState *s, const uint32_t seq) {
+  return s->seq != seq;
+}
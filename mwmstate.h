@@ -0,0 +1,60 @@
+#ifndef MWMSTATE_H
+#define MWMSTATE_H
+
+#include <stdint.h>
+
+/**
+ * read-only state page published by mwm in shared memory
+ *
+ * the page is named MWMSTATE_NAME followed by $DISPLAY and is
+ * rewritten by mwm under a seqlock: seq is odd while a write is
+ * in progress, a copy is consistent if seq was even and did not
+ * change while copying (see mwmstate_read). a writer that died
+ * may leave seq odd, mwmstate_read then fails.
+ *
+ * clients live in fixed slots, each desktop links its clients in
+ * list order from head through next, curr is the focused client.
+ * slot numbers are stable for the life of a client.
+ */
+#define MWMSTATE_NAME     "/mwm"
+#define MWMSTATE_MAGIC    0x6d776d73
+#define MWMSTATE_VERSION  1
+#define MWMSTATE_MONS     16
+#define MWMSTATE_DESKTOPS 32
+#define MWMSTATE_CLIENTS  1024
+#define MWMSTATE_NONE     (-1)
+
+enum { MWMSTATE_URGENT = 1 << 0, MWMSTATE_FULLSCREEN = 1 << 1, MWMSTATE_FIXED = 1 << 2,
+       MWMSTATE_TRANSIENT = 1 << 3, MWMSTATE_MONOCLE = 1 << 4 };
+
+typedef struct {
+  int32_t x, y, w, h, currdesk, prevdesk;
+} MwmStateMonitor;
+
+typedef struct {
+  int32_t mode, nclients, head, curr; /* mode as in mwm.c, head and curr are slots */
+} MwmStateDesktop;
+
+typedef struct {
+  uint64_t win; /* None if the slot is free */
+  int32_t mon, desk, next;
+  uint32_t flags;
+} MwmStateClient;
+
+typedef struct {
+  uint32_t magic, version;
+  volatile uint32_t seq;
+  int32_t pid; /* 0 once mwm exited, the page must be reopened */
+  int32_t nmons, ndesktops, currmon, overflow; /* clients without a slot */
+  MwmStateMonitor mons[MWMSTATE_MONS];
+  MwmStateDesktop desktops[MWMSTATE_MONS][MWMSTATE_DESKTOPS];
+  MwmStateClient clients[MWMSTATE_CLIENTS];
+} MwmState;
+
+const MwmState *mwmstate_open(const char *);
+void mwmstate_close(const MwmState *);
+int mwmstate_read(const MwmState *, MwmState *);
+int mwmstate_changed(const MwmState *, const uint32_t);
+int mwmstate_alive(const MwmState *);
+
+#endif
@@ -0,0 +1,127 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include "osd.h"
+
+#define PAD     6  /* between the text and the border */
+#define BORDER  2
+#define MAXTEXT 1024
+
+/**
+ * on-screen display, the notification backend without a daemon
+ *
+ * an override-redirect window of mwm showing the lines of the last
+ * notification with core X fonts, in the encoding of the locale as
+ * window titles are fetched. the text is drawn into a pixmap
+ * that is the background of the window, so the server repaints it
+ * on its own and a notification is drawn again only if its text or
+ * urgency changed. hiding it is left to the caller, on a timer.
+ */
+static Display *dpy;
+static Window win;
+static Pixmap pix;
+static GC gc;
+static XFontSet fs;
+static unsigned long fg, bg, border, urgent;
+static int ascent, lineh, pw, ph;
+static char text[MAXTEXT];
+static unsigned char texturg = 0xff; /* urgency the text was drawn with */
+static Bool ismapped;
+
+static Bool color(const char *name, unsigned long *pixel) {
+  XColor c;
+  Colormap map = DefaultColormap(dpy, DefaultScreen(dpy));
+  if (!XParseColor(dpy, map, name, &c) || !XAllocColor(dpy, map, &c))
+    return False;
+  *pixel = c.pixel;
+  return True;
+}
+
+/**
+ * load the font and colors and create the window, unmapped.
+ * returns False if the font cannot be loaded
+ */
+Bool osd_open(Display *d, const char *font, const char *fgname, const char *bgname, const char *urgname) {
+  char **missing = NULL, *def = NULL;
+  int nmissing = 0;
+  dpy = d;
+  fs = XCreateFontSet(dpy, font, &missing, &nmissing, &def);
+  if (missing)
+    XFreeStringList(missing);
+  if (!fs)
+    return False;
+
+  XFontSetExtents *ext = XExtentsOfFontSet(fs);
+  ascent = -ext->max_logical_extent.y;
+  lineh = ext->max_logical_extent.height;
+  if (!color(fgname, &fg) || !color(bgname, &bg) || !color(urgname, &urgent))
+    fg = WhitePixel(dpy, DefaultScreen(dpy)), bg = BlackPixel(dpy, DefaultScreen(dpy)), urgent = fg;
+  border = fg;
+
+  Window root = DefaultRootWindow(dpy);
+  win = XCreateWindow(dpy, root, 0, 0, 1, 1, BORDER, CopyFromParent, InputOutput, CopyFromParent,
+      CWOverrideRedirect | CWBackPixel | CWBorderPixel,
+      &(XSetWindowAttributes){ .override_redirect = True, .background_pixel = bg, .border_pixel = border });
+  gc = XCreateGC(dpy, root, 0, NULL);
+  return True;
+}
+
+/**
+ * show body centered at the top of the area of width w at x, y.
+ * urgency 2 (critical) has a border of the urgent color
+ */
+void osd_show(const char body[], const unsigned char urg, const int x, const int y, const int w) {
+  if (!win)
+    return;
+  if (strcmp(text, body) || urg != texturg) {
+    XRectangle ink, logical;
+    int n = 0, width = 1, len = 0;
+    snprintf(text, sizeof text, "%s", body);
+    texturg = urg;
+    for (const char *l = text; *l; l += len + (l[len] == '\n'), n++) {
+      XmbTextExtents(fs, l, (len = strcspn(l, "\n")), &ink, &logical);
+      width = logical.width > width ? logical.width : width;
+    }
+
+    int nw = width + 2 * PAD, nh = (n ? n : 1) * lineh + 2 * PAD;
+    if (!pix || nw != pw || nh != ph) {
+      if (pix)
+        XFreePixmap(dpy, pix);
+      pix = XCreatePixmap(dpy, win, (pw = nw), (ph = nh), DefaultDepth(dpy, DefaultScreen(dpy)));
+    }
+    XSetForeground(dpy, gc, bg);
+    XFillRectangle(dpy, pix, gc, 0, 0, pw, ph);
+    XSetForeground(dpy, gc, fg);
+    n = 0;
+    for (const char *l = text; *l; l += len + (l[len] == '\n'), n++)
+      XmbDrawString(dpy, pix, fs, gc, PAD, PAD + n * lineh + ascent, l, (len = strcspn(l, "\n")));
+    XSetWindowBackgroundPixmap(dpy, win, pix);
+    XSetWindowBorder(dpy, win, urg >= 2 ? urgent : border);
+    XClearWindow(dpy, win);
+  }
+  XMoveResizeWindow(dpy, win, x + (w - pw) / 2 - BORDER, y, pw, ph);
+  XMapRaised(dpy, win);
+  ismapped = True;
+}
+
+void osd_hide(void) {
+  if (ismapped)
+    XUnmapWindow(dpy, win);
+  ismapped = False;
+}
+
+void osd_close(void) {
+  if (!win)
+    return;
+  if (pix)
+    XFreePixmap(dpy, pix);
+  XFreeGC(dpy, gc);
+  XDestroyWindow(dpy, win);
+  XFreeFontSet(dpy, fs);
+  win = None;
+  pix = None;
+}
@@ -0,0 +1,11 @@
+#ifndef OSD_H
+#define OSD_H
+
+#include <X11/Xlib.h>
+
+Bool osd_open(Display *, const char *, const char *, const char *, const char *);
+void osd_show(const char [], const unsigned char, const int, const int, const int);
+void osd_hide(void);
+void osd_close(void);
+
+#endif
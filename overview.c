@@ -0,0 +1,359 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xrender.h>
+#include "overview.h"
+
+#define GAP   12 /* around a thumbnail in its cell */
+#define FRAME 3  /* around the chosen thumbnail */
+
+/**
+ * thumbnails of the client windows, for the overview
+ *
+ * a tracked window is redirected, so it keeps its content while
+ * covered or outside the screen, and has a damage object that reports
+ * once when the content changes. the thumbnail is scaled down from the
+ * window by XRender only when needed: when the overview shows it, or
+ * before the window is unmapped and loses its content (see
+ * overview_unmap). windows that did not change are not read again, so
+ * opening the overview costs one capture per changed window and one
+ * composite per thumbnail. like the on-screen display, the overview
+ * is drawn into a pixmap that is the background of its window.
+ */
+typedef struct {
+  Window win;
+  Damage damage;
+  Picture pict; /* of the window, with its subwindows */
+  Pixmap pix; /* the thumbnail, None until captured */
+  Picture thumb;
+  int ww, wh, w, h; /* of the window as last reported, of the thumbnail */
+  Bool isdirty; /* changed since it was captured */
+  Bool isunmapped; /* no content until it is damaged again */
+  Bool isredirected;
+} Thumb;
+
+static Display *dpy;
+static Window root, win;
+static Thumb *thumbs;
+static int nthumbs, thumbssz, size;
+static int damageev = -1, damageerr, rendererr;
+static XRenderPictFormat *fmt; /* of the default visual */
+static XRenderColor bg, fg, sel;
+static Pixmap canvas;
+static Picture canvaspict;
+static int cw, ch;
+/* the windows by cell, None once gone */
+static Window *shown;
+static int nshown, shownsz, cols, cellw, cellh, chosen;
+static Bool ismapped;
+
+static Thumb *find(const Window w) {
+  for (int i = 0; i < nthumbs; i++)
+    if (thumbs[i].win == w)
+      return &thumbs[i];
+  return NULL;
+}
+
+/* sample p of sw x sh as if it were dw x dh */
+static void scale(const Picture p, const int sw, const int sh, const int dw, const int dh) {
+  XTransform xf = { { { XDoubleToFixed((double) sw / dw), 0, 0 },
+                      { 0, XDoubleToFixed((double) sh / dh), 0 },
+                      { 0, 0, XDoubleToFixed(1) } } };
+  XRenderSetPictureTransform(dpy, p, &xf);
+}
+
+/**
+ * scale the window into its thumbnail and start collecting damage
+ * again. a window not redirected shows what covers it, so is left
+ */
+static void capture(Thumb *t) {
+  if (!t->isredirected || t->isunmapped || t->ww <= 0 || t->wh <= 0)
+    return;
+  double s = (double) size / (t->ww > t->wh ? t->ww : t->wh);
+  int w = s < 1 ? t->ww * s : t->ww, h = s < 1 ? t->wh * s : t->wh;
+  w = w > 0 ? w : 1;
+  h = h > 0 ? h : 1;
+
+  XDamageSubtract(dpy, t->damage, None, None);
+  t->isdirty = False;
+  if (w != t->w || h != t->h) {
+    if (t->pix) {
+      XRenderFreePicture(dpy, t->thumb);
+      XFreePixmap(dpy, t->pix);
+    }
+    t->pix = XCreatePixmap(dpy, root, (t->w = w), (t->h = h), DefaultDepth(dpy, DefaultScreen(dpy)));
+    t->thumb = XRenderCreatePicture(dpy, t->pix, fmt, 0, NULL);
+    XRenderSetPictureFilter(dpy, t->thumb, FilterBilinear, NULL, 0);
+  }
+  scale(t->pict, t->ww, t->wh, w, h);
+  XRenderComposite(dpy, PictOpSrc, t->pict, None, t->thumb, 0, 0, 0, 0, 0, 0, w, h);
+}
+
+/**
+ * draw the thumbnail of cell i fitted in it, on a frame if it is the
+ * chosen one. a window never captured is an empty box
+ */
+static void drawcell(const int i) {
+  int x = i % cols * cellw, y = i / cols * cellh, aw = cellw - 2 * GAP, ah = cellh - 2 * GAP;
+  Thumb *t = shown[i] ? find(shown[i]) : NULL;
+  XRenderFillRectangle(dpy, PictOpSrc, canvaspict, &bg, x, y, cellw, cellh);
+  if (aw <= 0 || ah <= 0 || !shown[i])
+    return;
+
+  int w = aw / 2, h = ah / 2;
+  if (t && t->pix) {
+    w = aw, h = ah;
+    if (t->w * ah > t->h * aw)
+      h = aw * t->h / t->w;
+    else
+      w = ah * t->w / t->h;
+    w = w > 0 ? w : 1;
+    h = h > 0 ? h : 1;
+  }
+  x += (cellw - w) / 2;
+  y += (cellh - h) / 2;
+  if (i == chosen)
+    XRenderFillRectangle(dpy, PictOpSrc, canvaspict, &sel, x - FRAME, y - FRAME, w + 2 * FRAME, h + 2 * FRAME);
+  if (t && t->pix) {
+    scale(t->thumb, t->w, t->h, w, h);
+    XRenderComposite(dpy, PictOpSrc, t->thumb, None, canvaspict, 0, 0, 0, 0, x, y, w, h);
+  } else
+    XRenderFillRectangle(dpy, PictOpSrc, canvaspict, &fg, x, y, w, h);
+}
+
+/* the background is undefined once its pixmap is drawn to, set it again */
+static void repaint(const int i) {
+  XSetWindowBackgroundPixmap(dpy, win, canvas);
+  XClearArea(dpy, win, i % cols * cellw, i / cols * cellh, cellw, cellh, False);
+}
+
+/**
+ * query the extensions and create the window, unmapped. returns
+ * False, and windows are not tracked, if one of Composite, Damage
+ * or Render is missing. thumbnails are at most size pixels wide and
+ * high, the overview is filled with bg, empty boxes with fg and the
+ * frame of the chosen thumbnail with selname
+ */
+Bool overview_open(Display *d, const int sz, const char *bgname, const char *fgname, const char *selname) {
+  int ev, er, major = 0, minor = 2, dmajor = 1, dminor = 1;
+  dpy = d;
+  root = DefaultRootWindow(dpy);
+  if (!XCompositeQueryExtension(dpy, &ev, &er) || !XCompositeQueryVersion(dpy, &major, &minor)
+      || !XRenderQueryExtension(dpy, &ev, &rendererr)
+      || !XDamageQueryExtension(dpy, &ev, &damageerr) || !XDamageQueryVersion(dpy, &dmajor, &dminor))
+    return False;
+  if (!(fmt = XRenderFindVisualFormat(dpy, DefaultVisual(dpy, DefaultScreen(dpy)))))
+    return False;
+  damageev = ev;
+  size = sz;
+
+  if (!XRenderParseColor(dpy, (char *) bgname, &bg) || !XRenderParseColor(dpy, (char *) fgname, &fg)
+      || !XRenderParseColor(dpy, (char *) selname, &sel)) {
+    bg = (XRenderColor){ 0, 0, 0, 0xffff };
+    fg = sel = (XRenderColor){ 0xffff, 0xffff, 0xffff, 0xffff };
+  }
+  win = XCreateWindow(dpy, root, 0, 0, 1, 1, 0, CopyFromParent, InputOutput, CopyFromParent,
+      CWOverrideRedirect, &(XSetWindowAttributes){ .override_redirect = True });
+  return True;
+}
+
+/**
+ * redirect w and collect its damage, of size ww x wh and
+ * visual as the window attributes tell. isviewable if it
+ * is mapped already and so has content
+ */
+void overview_track(const Window w, const int ww, const int wh, Visual *visual, const Bool isviewable) {
+  if (damageev < 0 || find(w))
+    return;
+  if (nthumbs == thumbssz) {
+    thumbssz = thumbssz ? thumbssz * 2 : 32;
+    if (!(thumbs = realloc(thumbs, thumbssz * sizeof *thumbs)))
+      err(EXIT_FAILURE, "cannot allocate thumbnails");
+  }
+  XRenderPictFormat *f = visual ? XRenderFindVisualFormat(dpy, visual) : NULL;
+  Thumb *t = &thumbs[nthumbs++];
+  *t = (Thumb){ .win = w, .ww = ww, .wh = wh, .isdirty = True, .isunmapped = !isviewable, .isredirected = True };
+  XCompositeRedirectWindow(dpy, w, CompositeRedirectAutomatic);
+  t->damage = XDamageCreate(dpy, w, XDamageReportNonEmpty);
+  t->pict = XRenderCreatePicture(dpy, w, f ? f : fmt, CPSubwindowMode,
+      &(XRenderPictureAttributes){ .subwindow_mode = IncludeInferiors });
+  XRenderSetPictureFilter(dpy, t->pict, FilterBilinear, NULL, 0);
+}
+
+/**
+ * forget w, which may be destroyed already, then
+ * the errors of freeing what went with it are expected
+ */
+void overview_untrack(const Window w) {
+  Thumb *t = find(w);
+  if (!t)
+    return;
+  XDamageDestroy(dpy, t->damage);
+  XRenderFreePicture(dpy, t->pict);
+  if (t->pix) {
+    XRenderFreePicture(dpy, t->thumb);
+    XFreePixmap(dpy, t->pix);
+  }
+  if (t->isredirected)
+    XCompositeUnredirectWindow(dpy, w, CompositeRedirectAutomatic);
+  *t = thumbs[--nthumbs];
+  for (int i = 0; i < nshown; i++)
+    if (shown[i] == w) {
+      shown[i] = None;
+      if (ismapped) {
+        drawcell(i);
+        repaint(i);
+      }
+    }
+}
+
+/**
+ * w is about to be unmapped, keep what it shows now
+ */
+void overview_unmap(const Window w) {
+  Thumb *t = find(w);
+  if (!t)
+    return;
+  if (t->isdirty)
+    capture(t);
+  t->isunmapped = True;
+}
+
+/**
+ * redirect w again, or stop, so that a fullscreen window is
+ * drawn straight to the screen. its thumbnail is kept meanwhile
+ */
+void overview_redirect(const Window w, const Bool isredirected) {
+  Thumb *t = find(w);
+  if (!t || t->isredirected == isredirected)
+    return;
+  if (isredirected)
+    XCompositeRedirectWindow(dpy, w, CompositeRedirectAutomatic);
+  else {
+    if (t->isdirty)
+      capture(t);
+    XCompositeUnredirectWindow(dpy, w, CompositeRedirectAutomatic);
+  }
+  t->isredirected = isredirected;
+}
+
+/**
+ * handle e if it is a damage event and return whether it was. the
+ * window is only marked changed, unless the overview shows it
+ */
+Bool overview_damage(const XEvent *e) {
+  if (damageev < 0 || e->type != damageev + XDamageNotify)
+    return False;
+  const XDamageNotifyEvent *de = (const XDamageNotifyEvent *) e;
+  Thumb *t = find(de->drawable);
+  if (!t)
+    return True;
+  t->ww = de->geometry.width;
+  t->wh = de->geometry.height;
+  t->isdirty = True;
+  t->isunmapped = False;
+  for (int i = 0; ismapped && i < nshown; i++)
+    if (shown[i] == t->win) {
+      capture(t);
+      drawcell(i);
+      repaint(i);
+    }
+  return True;
+}
+
+/**
+ * whether ee is of freeing the damage or picture of a destroyed window
+ */
+Bool overview_iserror(const XErrorEvent *ee) {
+  return damageev >= 0 && (ee->error_code == damageerr + BadDamage || ee->error_code == rendererr + BadPicture);
+}
+
+/**
+ * show the n windows in a grid over the area w x h at x, y, with
+ * the one at index choice framed. only the windows that changed
+ * since they were last captured are read. returns the number of
+ * columns, 0 if nothing is shown
+ */
+int overview_show(const Window *wins, const int n, const int choice, const int x, const int y, const int w, const int h) {
+  if (damageev < 0 || n <= 0)
+    return 0;
+  if (n > shownsz) {
+    shownsz = n;
+    if (!(shown = realloc(shown, shownsz * sizeof *shown)))
+      err(EXIT_FAILURE, "cannot allocate overview");
+  }
+  memcpy(shown, wins, n * sizeof *shown);
+  nshown = n;
+  chosen = choice;
+  for (cols = 1; cols * cols < n; cols++);
+  cellw = w / cols;
+  cellh = h / ((n + cols - 1) / cols);
+
+  if (!canvas || w != cw || h != ch) {
+    if (canvas) {
+      XRenderFreePicture(dpy, canvaspict);
+      XFreePixmap(dpy, canvas);
+    }
+    canvas = XCreatePixmap(dpy, root, (cw = w), (ch = h), DefaultDepth(dpy, DefaultScreen(dpy)));
+    canvaspict = XRenderCreatePicture(dpy, canvas, fmt, 0, NULL);
+  }
+  XRenderFillRectangle(dpy, PictOpSrc, canvaspict, &bg, 0, 0, cw, ch);
+  for (int i = 0; i < n; i++) {
+    Thumb *t = find(wins[i]);
+    if (t && t->isdirty)
+      capture(t);
+    drawcell(i);
+  }
+  XSetWindowBackgroundPixmap(dpy, win, canvas);
+  XMoveResizeWindow(dpy, win, x, y, w, h);
+  XMapRaised(dpy, win);
+  XClearWindow(dpy, win);
+  ismapped = True;
+  return cols;
+}
+
+/**
+ * move the frame to the thumbnail at index choice
+ */
+void overview_select(const int choice) {
+  int old = chosen;
+  if (!ismapped || choice < 0 || choice >= nshown)
+    return;
+  chosen = choice;
+  drawcell(old);
+  repaint(old);
+  drawcell(chosen);
+  repaint(chosen);
+}
+
+void overview_hide(void) {
+  if (ismapped)
+    XUnmapWindow(dpy, win);
+  ismapped = False;
+}
+
+void overview_close(void) {
+  if (!win)
+    return;
+  overview_hide();
+  while (nthumbs)
+    overview_untrack(thumbs[0].win);
+  if (canvas) {
+    XRenderFreePicture(dpy, canvaspict);
+    XFreePixmap(dpy, canvas);
+  }
+  XDestroyWindow(dpy, win);
+  free(thumbs);
+  free(shown);
+  win = None;
+  canvas = None;
+  thumbs = NULL;
+  shown = NULL;
+  nthumbs = thumbssz = nshown = shownsz = 0;
+  damageev = -1;
+}
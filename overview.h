@@ -0,0 +1,18 @@
+#ifndef OVERVIEW_H
+#define OVERVIEW_H
+
+#include <X11/Xlib.h>
+
+Bool overview_open(Display *, const int, const char *, const char *, const char *);
+void overview_track(const Window, const int, const int, Visual *, const Bool);
+void overview_untrack(const Window);
+void overview_unmap(const Window);
+void overview_redirect(const Window, const Bool);
+Bool overview_damage(const XEvent *);
+Bool overview_iserror(const XErrorEvent *);
+int overview_show(const Window *, const int, const int, const int, const int, const int, const int);
+void overview_select(const int);
+void overview_hide(void);
+void overview_close(void);
+
+#endif
@@ -0,0 +1,53 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "rc.h"
+
+/**
+ * line oriented reader of the runtime configuration file
+ *
+ * blank lines and lines starting with # are skipped, words are
+ * separated by blanks and a "double quoted" word may contain blanks.
+ * f is called with the words of every other line, its number and arg,
+ * the words point into a buffer that is reused for the next line.
+ * returns -1 if the file cannot be opened, 0 otherwise.
+ */
+int rcread(const char *path, void (*f)(int, char *[], int, void *), void *arg) {
+  FILE *fp = fopen(path, "r");
+  if (!fp)
+    return -1;
+  rcparse(fp, f, arg);
+  fclose(fp);
+  return 0;
+}
+
+/* the lines of an open stream, see rcread */
+void rcparse(FILE *fp, void (*f)(int, char *[], int, void *), void *arg) {
+  char *line = NULL, *words[RC_WORDS];
+  size_t sz = 0;
+  for (int n = 1; getline(&line, &sz, fp) != -1; n++) {
+    int argc = 0;
+    char *p = line, *w;
+    for (; isspace((unsigned char) *p); p++);
+    if (*p == '#')
+      continue;
+    while (*p && argc < RC_WORDS) {
+      if (isspace((unsigned char) *p)) {
+        p++;
+        continue;
+      }
+      if (*p == '"') {
+        for (w = ++p; *p && *p != '"'; p++);
+      } else
+        for (w = p; *p && !isspace((unsigned char) *p); p++);
+      if (*p)
+        *p++ = '\0';
+      words[argc++] = w;
+    }
+    if (argc)
+      f(argc, words, n, arg);
+  }
+  free(line);
+}
@@ -0,0 +1,11 @@
+#ifndef RC_H
+#define RC_H
+
+#include <stdio.h>
+
+#define RC_WORDS 64 /* words per line, the rest is dropped */
+
+int rcread(const char *, void (*)(int, char *[], int, void *), void *);
+void rcparse(FILE *, void (*)(int, char *[], int, void *), void *);
+
+#endif
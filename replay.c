@@ -0,0 +1,618 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <err.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/extensions/Xinerama.h>
+#include <X11/extensions/Xrandr.h>
+#include "trace.h"
+#include "rc.h"
+#include "osd.h"
+#include "overview.h"
+
+/**
+ * stub X backend replaying a trace recorded by trace.c
+ *
+ * linked into mwm_replay.bin in place of Xlib, Xinerama, RandR, dbus
+ * and the thumbnails of overview.c.
+ * calls returning data are answered from the trace in recorded
+ * order, requests are only counted. the event loop never waits,
+ * so a trace replays as fast as the handlers run, and the same
+ * trace always drives the handlers through the same path.
+ * when the trace is exhausted the totals are printed and
+ * the process exits.
+ */
+
+#define UNUSED __attribute__((unused))
+
+int __real_clock_gettime(clockid_t, struct timespec *);
+
+/* time spent on events of a type, the last counts extension events */
+typedef struct {
+  unsigned long n;
+  double ms, max;
+} Handler;
+
+static unsigned char *trace, *pos, *end;
+static unsigned long nevents, nrequests;
+static struct timespec start, handed;
+static Handler handlers[LASTEvent + 1];
+static int handling = -1; /* type of the event handed out last, -1 once accounted */
+
+static const char *evnames[LASTEvent] = {
+  [KeyPress] = "KeyPress", [KeyRelease] = "KeyRelease", [ButtonPress] = "ButtonPress",
+  [ButtonRelease] = "ButtonRelease", [MotionNotify] = "MotionNotify", [EnterNotify] = "EnterNotify",
+  [LeaveNotify] = "LeaveNotify", [FocusIn] = "FocusIn", [FocusOut] = "FocusOut",
+  [Expose] = "Expose", [DestroyNotify] = "DestroyNotify", [UnmapNotify] = "UnmapNotify",
+  [MapNotify] = "MapNotify", [MapRequest] = "MapRequest", [ReparentNotify] = "ReparentNotify",
+  [ConfigureNotify] = "ConfigureNotify", [ConfigureRequest] = "ConfigureRequest",
+  [PropertyNotify] = "PropertyNotify", [ClientMessage] = "ClientMessage",
+  [MappingNotify] = "MappingNotify",
+};
+
+static double since(const struct timespec *t0) {
+  struct timespec t;
+  __real_clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec - t0->tv_sec) * 1e3 + (t.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+/**
+ * charge the time since the last event was handed out to its type,
+ * that is its handler and the timers that ran before the next one
+ */
+static void account(void) {
+  if (handling < 0)
+    return;
+  double ms = since(&handed);
+  Handler *h = &handlers[handling];
+  h->n++;
+  h->ms += ms;
+  if (ms > h->max)
+    h->max = ms;
+  handling = -1;
+}
+
+static void finish(void) {
+  account();
+  double ms = since(&start);
+  fprintf(stderr, "replayed %lu events, %lu requests in %.3f ms (%.0f events/s)\n",
+      nevents, nrequests, ms, ms > 0 ? nevents / ms * 1e3 : 0);
+  fprintf(stderr, "%-18s %8s %10s %10s\n", "handler", "events", "mean us", "max us");
+  for (int i = 0; i <= LASTEvent; i++)
+    if (handlers[i].n)
+      fprintf(stderr, "%-18s %8lu %10.2f %10.2f\n", i == LASTEvent ? "extension"
+          : evnames[i] ? evnames[i] : "event", handlers[i].n,
+          handlers[i].ms * 1e3 / handlers[i].n, handlers[i].max * 1e3);
+}
+
+/**
+ * read the next record into p, which must be of the expected kind,
+ * and return its length. the part of p not covered is zeroed.
+ */
+static uint32_t get(const unsigned char kind, void *p, const size_t max) {
+  uint32_t len;
+  if (pos == end) {
+    finish();
+    exit(EXIT_SUCCESS);
+  } else if (end - pos < 1 + (long) sizeof len)
+    errx(EXIT_FAILURE, "trace truncated");
+
+  memcpy(&len, pos + 1, sizeof len);
+  if (*pos != kind)
+    errx(EXIT_FAILURE, "trace diverged at %ld: expected record %d, found %d",
+        (long) (pos - trace), kind, *pos);
+  else if (end - pos - 1 - (long) sizeof len < len)
+    errx(EXIT_FAILURE, "trace truncated");
+
+  pos += 1 + sizeof len;
+  if (p) {
+    memcpy(p, pos, len < max ? len : max);
+    if (len < max)
+      memset((unsigned char *) p + len, 0, max - len);
+  }
+  pos += len;
+  return len;
+}
+
+/* length of the next record, without consuming it */
+static uint32_t peek(void) {
+  uint32_t len = 0;
+  if (end - pos > (long) sizeof len)
+    memcpy(&len, pos + 1, sizeof len);
+  return len;
+}
+
+/**
+ * return a copy of the next data record, NULL if it is empty.
+ * one zero byte is appended, as Xlib does for properties.
+ */
+static void *getdata(uint32_t *len) {
+  uint32_t l = peek();
+  unsigned char *p = NULL;
+  if (l && !(p = calloc(1, l + 1)))
+    err(EXIT_FAILURE, "cannot allocate reply");
+  get(TR_DATA, p, l);
+  if (len)
+    *len = l;
+  return p;
+}
+
+Display *XOpenDisplay(UNUSED const char *name) {
+  const char *path = getenv("MWM_TRACE");
+  TraceOpen o;
+  FILE *f = fopen(path ? path : TRACE_FILE, "rb");
+  long n;
+  if (!f || fseek(f, 0, SEEK_END) || (n = ftell(f)) < 0 || fseek(f, 0, SEEK_SET))
+    err(EXIT_FAILURE, "cannot open trace %s", path ? path : TRACE_FILE);
+  if (!(trace = malloc(n)) || fread(trace, 1, n, f) != (size_t) n)
+    err(EXIT_FAILURE, "cannot read trace");
+  fclose(f);
+  if (n < (long) sizeof TRACE_MAGIC - 1 || memcmp(trace, TRACE_MAGIC, sizeof TRACE_MAGIC - 1))
+    errx(EXIT_FAILURE, "not an mwm trace");
+
+  pos = trace + sizeof TRACE_MAGIC - 1;
+  end = trace + n;
+  get(TR_OPEN, &o, sizeof o);
+
+  _XPrivDisplay d = NULL;
+  if (!(d = calloc(1, sizeof *d)) || !(d->screens = calloc(o.screen + 1, sizeof(Screen))))
+    err(EXIT_FAILURE, "cannot allocate display");
+  d->fd = -1;
+  d->default_screen = o.screen;
+  d->nscreens = o.screen + 1;
+  d->screens[o.screen].root = o.root;
+  d->screens[o.screen].cmap = o.cmap;
+  __real_clock_gettime(CLOCK_MONOTONIC, &start);
+  return (Display *) d;
+}
+
+int XCloseDisplay(Display *dpy) {
+  finish();
+  free(((_XPrivDisplay) dpy)->screens);
+  free(dpy);
+  free(trace);
+  return 0;
+}
+
+int XPending(UNUSED Display *dpy) {
+  int n;
+  get(TR_PENDING, &n, sizeof n);
+  return n;
+}
+
+int XNextEvent(Display *dpy, XEvent *e) {
+  account();
+  get(TR_EVENT, e, sizeof *e);
+  e->xany.display = dpy;
+  nevents++;
+  handling = e->type >= 0 && e->type < LASTEvent ? e->type : LASTEvent;
+  __real_clock_gettime(CLOCK_MONOTONIC, &handed);
+  return 0;
+}
+
+int XMaskEvent(Display *dpy, UNUSED long mask, XEvent *e) {
+  return XNextEvent(dpy, e);
+}
+
+int __wrap_poll(UNUSED struct pollfd *fds, UNUSED nfds_t n,
+    UNUSED int timeout) {
+  int r;
+  get(TR_POLL, &r, sizeof r);
+  return r;
+}
+
+int __wrap_clock_gettime(UNUSED clockid_t id, struct timespec *ts) {
+  get(TR_CLOCK, ts, sizeof *ts);
+  return 0;
+}
+
+/* never start the commands bound to keys, pretend to be the parent */
+pid_t __wrap_fork(void) {
+  nrequests++;
+  return 1;
+}
+
+/**
+ * the state page of the running mwm is left alone, replay
+ * publishes to an unlinked file of its own instead
+ */
+int __wrap_shm_open(UNUSED const char *name, UNUSED int flags, UNUSED mode_t mode) {
+  FILE *f = tmpfile();
+  int fd = f ? dup(fileno(f)) : -1;
+  if (f)
+    fclose(f);
+  return fd;
+}
+
+int __wrap_shm_unlink(UNUSED const char *name) {
+  return 0;
+}
+
+/**
+ * the pids of a trace are not those of this system, processes are
+ * neither stopped nor reniced and no cgroup is writable to freeze
+ */
+int __wrap_kill(UNUSED pid_t pid, UNUSED int sig) {
+  return 0;
+}
+
+int __wrap_setpriority(UNUSED int which, UNUSED id_t who, UNUSED int prio) {
+  return 0;
+}
+
+long __wrap_syscall(UNUSED long number, ...) {
+  return 0;
+}
+
+int __wrap_access(UNUSED const char *path, UNUSED int mode) {
+  errno = EACCES;
+  return -1;
+}
+
+void notify_send(UNUSED const char summ[], UNUSED const char body[],
+    UNUSED const unsigned char urg, UNUSED const unsigned int timeout_ms) {
+  nrequests++;
+}
+
+/* no fonts, notifications fall back to notify_send */
+Bool osd_open(UNUSED Display *dpy, UNUSED const char *font, UNUSED const char *fg,
+    UNUSED const char *bg, UNUSED const char *urgent) {
+  return False;
+}
+
+void osd_show(UNUSED const char body[], UNUSED const unsigned char urg,
+    UNUSED const int x, UNUSED const int y, UNUSED const int w) {
+}
+
+void osd_hide(void) {
+}
+
+void osd_close(void) {
+}
+
+/* nothing is tracked, the overview is laid out as overview.c does */
+Bool overview_open(UNUSED Display *dpy, UNUSED const int size, UNUSED const char *bg,
+    UNUSED const char *fg, UNUSED const char *sel) {
+  return False;
+}
+
+void overview_track(UNUSED const Window w, UNUSED const int ww, UNUSED const int wh,
+    UNUSED Visual *visual, UNUSED const Bool isviewable) {
+}
+
+void overview_untrack(UNUSED const Window w) {
+}
+
+void overview_unmap(UNUSED const Window w) {
+}
+
+void overview_redirect(UNUSED const Window w, UNUSED const Bool isredirected) {
+}
+
+Bool overview_damage(UNUSED const XEvent *e) {
+  return False;
+}
+
+Bool overview_iserror(UNUSED const XErrorEvent *ee) {
+  return False;
+}
+
+int overview_show(UNUSED const Window *wins, const int n, UNUSED const int choice, UNUSED const int x,
+    UNUSED const int y, UNUSED const int w, UNUSED const int h) {
+  int cols = 1;
+  for (; cols * cols < n; cols++);
+  return n > 0 ? cols : 0;
+}
+
+void overview_select(UNUSED const int choice) {
+  nrequests++;
+}
+
+void overview_hide(void) {
+}
+
+void overview_close(void) {
+}
+
+Status XGetWindowAttributes(UNUSED Display *dpy, UNUSED Window w, XWindowAttributes *wa) {
+  Status s;
+  get(TR_ATTRIBUTES, &s, sizeof s);
+  if (s)
+    get(TR_DATA, wa, sizeof *wa);
+  return s;
+}
+
+Status XGetClassHint(UNUSED Display *dpy, UNUSED Window w, XClassHint *ch) {
+  Status s;
+  get(TR_CLASSHINT, &s, sizeof s);
+  if (s) {
+    ch->res_name = getdata(NULL);
+    ch->res_class = getdata(NULL);
+  }
+  return s;
+}
+
+Status XGetTextProperty(UNUSED Display *dpy, UNUSED Window w,
+    XTextProperty *tp, UNUSED Atom a) {
+  TraceTextProp t;
+  get(TR_TEXTPROP, &t, sizeof t);
+  if (t.status) {
+    tp->encoding = t.encoding;
+    tp->format = t.format;
+    tp->nitems = t.nitems;
+    tp->value = getdata(NULL);
+  }
+  return t.status;
+}
+
+int XmbTextPropertyToTextList(UNUSED Display *dpy, UNUSED const XTextProperty *tp,
+    char ***list, int *n) {
+  int r[2];
+  get(TR_TEXTLIST, r, sizeof r);
+  if (r[0] < Success)
+    return r[0];
+  if (!(*list = calloc(r[1] + 1, sizeof(char *))))
+    err(EXIT_FAILURE, "cannot allocate text list");
+  for (int i = 0; i < r[1]; i++)
+    (*list)[i] = getdata(NULL);
+  *n = r[1];
+  return r[0];
+}
+
+void XFreeStringList(char **list) {
+  for (char **s = list; s && *s; s++)
+    free(*s);
+  free(list);
+}
+
+Status XGetTransientForHint(UNUSED Display *dpy, UNUSED Window w, Window *t) {
+  Status s;
+  get(TR_TRANSIENT, &s, sizeof s);
+  if (s)
+    get(TR_DATA, t, sizeof *t);
+  return s;
+}
+
+XWMHints *XGetWMHints(UNUSED Display *dpy, UNUSED Window w) {
+  XWMHints *wmh = NULL;
+  if (peek() && !(wmh = malloc(sizeof *wmh)))
+    err(EXIT_FAILURE, "cannot allocate hints");
+  get(TR_WMHINTS, wmh, wmh ? sizeof *wmh : 0);
+  return wmh;
+}
+
+Status XGetWMProtocols(UNUSED Display *dpy, UNUSED Window w, Atom **prot, int *n) {
+  Status s;
+  uint32_t len;
+  get(TR_PROTOCOLS, &s, sizeof s);
+  if (s) {
+    *prot = getdata(&len);
+    *n = len / sizeof(Atom);
+  }
+  return s;
+}
+
+int XGetWindowProperty(UNUSED Display *dpy, UNUSED Window w,
+    UNUSED Atom prop, UNUSED long off, UNUSED long len,
+    UNUSED Bool del, UNUSED Atom req,
+    Atom *type, int *format, unsigned long *nitems, unsigned long *after, unsigned char **data) {
+  TraceProperty t;
+  get(TR_PROPERTY, &t, sizeof t);
+  if (t.status == Success) {
+    *type = t.type;
+    *format = t.format;
+    *nitems = t.nitems;
+    *after = t.after;
+    *data = getdata(NULL);
+  }
+  return t.status;
+}
+
+Bool XQueryPointer(UNUSED Display *dpy, UNUSED Window w, Window *root, Window *child,
+    int *rx, int *ry, int *wx, int *wy, unsigned int *mask) {
+  TracePointer t;
+  get(TR_POINTER, &t, sizeof t);
+  *root = t.root;
+  *child = t.child;
+  *rx = t.rx;
+  *ry = t.ry;
+  *wx = t.wx;
+  *wy = t.wy;
+  *mask = t.mask;
+  return t.status;
+}
+
+Status XQueryTree(UNUSED Display *dpy, UNUSED Window w,
+    Window *root, Window *parent, Window **children, unsigned int *n) {
+  TraceTree t;
+  uint32_t len;
+  get(TR_TREE, &t, sizeof t);
+  if (t.status) {
+    *root = t.root;
+    *parent = t.parent;
+    *children = getdata(&len);
+    *n = len / sizeof(Window);
+  }
+  return t.status;
+}
+
+Atom XInternAtom(UNUSED Display *dpy, UNUSED const char *name,
+    UNUSED Bool exists) {
+  Atom a;
+  get(TR_ATOM, &a, sizeof a);
+  return a;
+}
+
+Status XAllocNamedColor(UNUSED Display *dpy, UNUSED Colormap map,
+    UNUSED const char *name, XColor *s, XColor *e) {
+  Status st;
+  get(TR_COLOR, &st, sizeof st);
+  if (st) {
+    get(TR_DATA, s, sizeof *s);
+    get(TR_DATA, e, sizeof *e);
+  }
+  return st;
+}
+
+XModifierKeymap *XGetModifierMapping(UNUSED Display *dpy) {
+  XModifierKeymap *map = NULL;
+  int n;
+  get(TR_MODMAP, &n, sizeof n);
+  if (n < 0)
+    return NULL;
+  if (!(map = malloc(sizeof *map)))
+    err(EXIT_FAILURE, "cannot allocate modifier map");
+  map->max_keypermod = n;
+  if (!(map->modifiermap = getdata(NULL)) && n)
+    errx(EXIT_FAILURE, "trace diverged: empty modifier map");
+  return map;
+}
+
+int XFreeModifiermap(XModifierKeymap *map) {
+  if (map)
+    free(map->modifiermap);
+  free(map);
+  return 0;
+}
+
+KeyCode XKeysymToKeycode(UNUSED Display *dpy, UNUSED KeySym sym) {
+  KeyCode code;
+  get(TR_KEYCODE, &code, sizeof code);
+  return code;
+}
+
+/**
+ * the keysyms of the names in the rc file, as Xlib resolved them
+ * when the trace was recorded
+ */
+KeySym XStringToKeysym(UNUSED const char *s) {
+  KeySym sym;
+  get(TR_KEYSYM, &sym, sizeof sym);
+  return sym;
+}
+
+/* the rc file as it was read when recording, not as it is now */
+int __wrap_rcread(UNUSED const char *path, void (*f)(int, char *[], int, void *), void *arg) {
+  int r;
+  uint32_t len;
+  get(TR_RC, &r, sizeof r);
+  if (r < 0)
+    return r;
+  char *text = getdata(&len);
+  FILE *fp = len ? fmemopen(text, len, "r") : NULL;
+  if (fp) {
+    rcparse(fp, f, arg);
+    fclose(fp);
+  }
+  free(text);
+  return r;
+}
+
+#if NeedWidePrototypes
+KeySym XkbKeycodeToKeysym(UNUSED Display *dpy, UNUSED unsigned int code,
+#else
+KeySym XkbKeycodeToKeysym(UNUSED Display *dpy, UNUSED KeyCode code,
+#endif
+    UNUSED int group, UNUSED int level) {
+  KeySym sym;
+  get(TR_KEYSYM, &sym, sizeof sym);
+  return sym;
+}
+
+XineramaScreenInfo *XineramaQueryScreens(UNUSED Display *dpy, int *n) {
+  get(TR_SCREENS, n, sizeof *n);
+  return getdata(NULL);
+}
+
+int XGrabPointer(UNUSED Display *dpy, UNUSED Window w,
+    UNUSED Bool owner, UNUSED unsigned int mask,
+    UNUSED int pmode, UNUSED int kmode, UNUSED Window confine,
+    UNUSED Cursor cursor, UNUSED Time t) {
+  int r;
+  get(TR_GRAB, &r, sizeof r);
+  return r;
+}
+
+int XGrabKeyboard(UNUSED Display *dpy, UNUSED Window w, UNUSED Bool owner,
+    UNUSED int pmode, UNUSED int kmode, UNUSED Time t) {
+  int r;
+  get(TR_GRAB, &r, sizeof r);
+  return r;
+}
+
+Bool XRRQueryExtension(UNUSED Display *dpy, int *event, int *error) {
+  TraceExtension t;
+  get(TR_EXTENSION, &t, sizeof t);
+  *event = t.event;
+  *error = t.error;
+  return t.present;
+}
+
+int XRRUpdateConfiguration(UNUSED XEvent *e) {
+  return 1;
+}
+
+void XRRSelectInput(Display *dpy, UNUSED Window w, UNUSED int mask) {
+  (void) dpy;
+  nrequests++;
+}
+
+int XFree(void *p) {
+  free(p);
+  return 1;
+}
+
+XErrorHandler XSetErrorHandler(UNUSED XErrorHandler h) {
+  return NULL;
+}
+
+/* requests, the server would answer none of them */
+#define REQUEST { (void) dpy; nrequests++; return 1; }
+
+int XChangeProperty(Display *dpy, UNUSED Window w, UNUSED Atom p, UNUSED Atom t, UNUSED int f, UNUSED int m,
+    UNUSED const unsigned char *d, UNUSED int n) REQUEST
+int XChangeWindowAttributes(Display *dpy, UNUSED Window w, UNUSED unsigned long m,
+    UNUSED XSetWindowAttributes *a) REQUEST
+int XConfigureWindow(Display *dpy, UNUSED Window w, UNUSED unsigned int m, UNUSED XWindowChanges *c) REQUEST
+int XDeleteProperty(Display *dpy, UNUSED Window w, UNUSED Atom p) REQUEST
+/* requests are not numbered, recorded crossings are never taken for mwm's own */
+int XNoOp(Display *dpy) REQUEST
+int XGrabButton(Display *dpy, UNUSED unsigned int b, UNUSED unsigned int m, UNUSED Window w, UNUSED Bool o,
+    UNUSED unsigned int e, UNUSED int pm, UNUSED int km, UNUSED Window c, UNUSED Cursor cur) REQUEST
+int XUngrabButton(Display *dpy, UNUSED unsigned int b, UNUSED unsigned int m, UNUSED Window w) REQUEST
+int XGrabKey(Display *dpy, UNUSED int k, UNUSED unsigned int m, UNUSED Window w, UNUSED Bool o,
+    UNUSED int pm, UNUSED int km) REQUEST
+int XUngrabKey(Display *dpy, UNUSED int k, UNUSED unsigned int m, UNUSED Window w) REQUEST
+int XUngrabPointer(Display *dpy, UNUSED Time t) REQUEST
+int XUngrabKeyboard(Display *dpy, UNUSED Time t) REQUEST
+int XKillClient(Display *dpy, UNUSED XID r) REQUEST
+int XGrabServer(Display *dpy) REQUEST
+int XRefreshKeyboardMapping(UNUSED XMappingEvent *e) { return 1; }
+Bool XSupportsLocale(void) { return True; }
+int XUngrabServer(Display *dpy) REQUEST
+int XMapWindow(Display *dpy, UNUSED Window w) REQUEST
+int XUnmapWindow(Display *dpy, UNUSED Window w) REQUEST
+int XMoveWindow(Display *dpy, UNUSED Window w, UNUSED int x, UNUSED int y) REQUEST
+int XResizeWindow(Display *dpy, UNUSED Window w, UNUSED unsigned int ww, UNUSED unsigned int wh) REQUEST
+int XMoveResizeWindow(Display *dpy, UNUSED Window w, UNUSED int x, UNUSED int y,
+    UNUSED unsigned int ww, UNUSED unsigned int wh) REQUEST
+int XRaiseWindow(Display *dpy, UNUSED Window w) REQUEST
+int XRestackWindows(Display *dpy, UNUSED Window *w, UNUSED int n) REQUEST
+int XSelectInput(Display *dpy, UNUSED Window w, UNUSED long m) REQUEST
+Status XSendEvent(Display *dpy, UNUSED Window w, UNUSED Bool p, UNUSED long m, UNUSED XEvent *e) REQUEST
+int XSetInputFocus(Display *dpy, UNUSED Window w, UNUSED int r, UNUSED Time t) REQUEST
+int XSetWindowBorder(Display *dpy, UNUSED Window w, UNUSED unsigned long p) REQUEST
+int XSetWindowBorderWidth(Display *dpy, UNUSED Window w, UNUSED unsigned int bw) REQUEST
+int XWarpPointer(Display *dpy, UNUSED Window s, UNUSED Window d, UNUSED int sx, UNUSED int sy,
+    UNUSED unsigned int sw, UNUSED unsigned int sh, UNUSED int dx, UNUSED int dy) REQUEST
+int XSync(Display *dpy, UNUSED Bool discard) REQUEST
+int XFlush(Display *dpy) REQUEST
@@ -0,0 +1,110 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include "search.h"
+
+#define QUERYSZ 256
+
+/**
+ * index of the items the switcher searches, by title and class
+ *
+ * an item is given an entry by search_add, whose number stays the
+ * same until search_del, and its text is kept folded to lower case
+ * by search_set, so a query only compares bytes. a query that
+ * extends the last one, as typing does, only looks again at the
+ * entries the last one matched, unless the index changed since.
+ */
+typedef struct {
+  const void *item; /* NULL if the entry is free */
+  char *text; /* title and class, lower case */
+} Entry;
+
+static Entry *entries;
+static int nentries, entriessz, *freeids, nfreeids;
+static int *hits, nhits;
+static const void **found;
+static char last[QUERYSZ];
+static unsigned long gen, lastgen = -1;
+
+/* ascii only, other bytes of utf-8 titles are compared as they are */
+static char fold(const char c) {
+  return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+int search_add(const void *item) {
+  int id = nfreeids ? freeids[--nfreeids] : nentries;
+  if (id == entriessz) {
+    entriessz = entriessz ? entriessz * 2 : 64;
+    if (!(entries = realloc(entries, entriessz * sizeof *entries))
+        || !(freeids = realloc(freeids, entriessz * sizeof *freeids))
+        || !(hits = realloc(hits, entriessz * sizeof *hits))
+        || !(found = realloc(found, entriessz * sizeof *found)))
+      err(EXIT_FAILURE, "cannot allocate search index");
+  }
+  if (id == nentries)
+    nentries++;
+  entries[id] = (Entry){ item, NULL };
+  gen++;
+  return id;
+}
+
+void search_set(const int id, const char *title, const char *class) {
+  size_t tl = strlen(title ? title : ""), cl = strlen(class ? class : "");
+  char *s = realloc(entries[id].text, tl + cl + 2);
+  if (!s)
+    err(EXIT_FAILURE, "cannot allocate search index");
+  /* a separator no query has, so that a match is within one of them */
+  for (size_t i = 0; i < tl; i++)
+    s[i] = fold(title[i]);
+  s[tl] = '\n';
+  for (size_t i = 0; i < cl; i++)
+    s[tl + 1 + i] = fold(class[i]);
+  s[tl + 1 + cl] = '\0';
+  entries[id].text = s;
+  gen++;
+}
+
+void search_del(const int id) {
+  if (id < 0)
+    return;
+  free(entries[id].text);
+  entries[id] = (Entry){ NULL, NULL };
+  freeids[nfreeids++] = id;
+  gen++;
+}
+
+/**
+ * find the items whose text has the query, ignoring case
+ *
+ * returns how many, in the order of their entries, and points
+ * items to them, which is valid until the next call
+ */
+int search_query(const char *query, const void ***items) {
+  char q[QUERYSZ];
+  size_t n = 0;
+  for (; query[n] && n < sizeof q - 1; n++)
+    q[n] = fold(query[n]);
+  q[n] = '\0';
+
+  if (gen == lastgen && !strncmp(q, last, strlen(last))) {
+    int k = 0;
+    for (int i = 0; i < nhits; i++)
+      if (strstr(entries[hits[i]].text, q))
+        hits[k++] = hits[i];
+    nhits = k;
+  } else {
+    nhits = 0;
+    for (int i = 0; i < nentries; i++)
+      if (entries[i].item && strstr(entries[i].text ? entries[i].text : "", q))
+        hits[nhits++] = i;
+  }
+  memcpy(last, q, n + 1);
+  lastgen = gen;
+
+  for (int i = 0; i < nhits; i++)
+    found[i] = entries[hits[i]].item;
+  *items = found;
+  return nhits;
+}
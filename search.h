@@ -0,0 +1,9 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+int search_add(const void *);
+void search_set(const int, const char *, const char *);
+void search_del(const int);
+int search_query(const char *, const void ***);
+
+#endif
@@ -0,0 +1,68 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <err.h>
+#include "strtab.h"
+
+#define BUCKETS 256 /* power of two */
+
+/**
+ * interned, reference counted strings
+ *
+ * every distinct string is stored once, clients of the same
+ * class share the same copy and titles are compared by pointer.
+ * the returned pointer is the payload of the entry, so releasing
+ * a string finds its entry without a lookup.
+ */
+typedef struct Str {
+  struct Str *next;
+  unsigned int hash, refs;
+  char s[];
+} Str;
+
+static Str *table[BUCKETS];
+
+static unsigned int strhash(const char *s) {
+  unsigned int h = 2166136261u;
+  while (*s)
+    h = (h ^ (unsigned char) *s++) * 16777619u;
+  return h;
+}
+
+const char *strintern(const char *s) {
+  if (!s)
+    return NULL;
+
+  unsigned int h = strhash(s);
+  Str *e = table[h & (BUCKETS - 1)];
+  for (; e && (e->hash != h || strcmp(e->s, s)); e = e->next);
+  if (e) {
+    e->refs++;
+    return e->s;
+  }
+
+  size_t len = strlen(s) + 1;
+  if (!(e = malloc(sizeof *e + len)))
+    err(EXIT_FAILURE, "cannot allocate string");
+  memcpy(e->s, s, len);
+  e->hash = h;
+  e->refs = 1;
+  e->next = table[h & (BUCKETS - 1)];
+  table[h & (BUCKETS - 1)] = e;
+  return e->s;
+}
+
+void strrelease(const char *s) {
+  if (!s)
+    return;
+
+  Str *e = (Str *) (s - offsetof(Str, s)), **p = &table[e->hash & (BUCKETS - 1)];
+  if (--e->refs)
+    return;
+  for (; *p && *p != e; p = &(*p)->next);
+  if (*p)
+    *p = e->next;
+  free(e);
+}
@@ -0,0 +1,7 @@
+#ifndef STRTAB_H
+#define STRTAB_H
+
+const char *strintern(const char *);
+void strrelease(const char *);
+
+#endif
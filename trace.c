@@ -0,0 +1,367 @@
+/* see LICENSE for copyright and license */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <err.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/extensions/Xinerama.h>
+#include <X11/extensions/Xrandr.h>
+#include "trace.h"
+#include "rc.h"
+
+/**
+ * X event recorder
+ *
+ * linked into mwm_rec.bin with -Wl,--wrap for every call through
+ * which mwm receives data (see TRACEWRAP in the Makefile).
+ * each wrapper calls the real function and appends what it
+ * returned to the trace, which replay.c feeds back to the
+ * handlers in the same order.
+ */
+
+Display *__real_XOpenDisplay(const char *);
+int __real_XCloseDisplay(Display *);
+int __real_XPending(Display *);
+int __real_XNextEvent(Display *, XEvent *);
+int __real_XMaskEvent(Display *, long, XEvent *);
+int __real_poll(struct pollfd *, nfds_t, int);
+int __real_clock_gettime(clockid_t, struct timespec *);
+pid_t __real_fork(void);
+Status __real_XGetWindowAttributes(Display *, Window, XWindowAttributes *);
+Status __real_XGetClassHint(Display *, Window, XClassHint *);
+Status __real_XGetTextProperty(Display *, Window, XTextProperty *, Atom);
+int __real_XmbTextPropertyToTextList(Display *, const XTextProperty *, char ***, int *);
+Status __real_XGetTransientForHint(Display *, Window, Window *);
+XWMHints *__real_XGetWMHints(Display *, Window);
+Status __real_XGetWMProtocols(Display *, Window, Atom **, int *);
+int __real_XGetWindowProperty(Display *, Window, Atom, long, long, Bool, Atom,
+    Atom *, int *, unsigned long *, unsigned long *, unsigned char **);
+Bool __real_XQueryPointer(Display *, Window, Window *, Window *, int *, int *, int *, int *, unsigned int *);
+Status __real_XQueryTree(Display *, Window, Window *, Window *, Window **, unsigned int *);
+Atom __real_XInternAtom(Display *, const char *, Bool);
+Status __real_XAllocNamedColor(Display *, Colormap, const char *, XColor *, XColor *);
+XModifierKeymap *__real_XGetModifierMapping(Display *);
+KeyCode __real_XKeysymToKeycode(Display *, KeySym);
+KeySym __real_XStringToKeysym(const char *);
+#if NeedWidePrototypes
+KeySym __real_XkbKeycodeToKeysym(Display *, unsigned int, int, int);
+#else
+KeySym __real_XkbKeycodeToKeysym(Display *, KeyCode, int, int);
+#endif
+XineramaScreenInfo *__real_XineramaQueryScreens(Display *, int *);
+int __real_XGrabPointer(Display *, Window, Bool, unsigned int, int, int, Window, Cursor, Time);
+int __real_XGrabKeyboard(Display *, Window, Bool, int, int, Time);
+Bool __real_XRRQueryExtension(Display *, int *, int *);
+
+static FILE *trace;
+
+static void put(const unsigned char kind, const void *p, const size_t len) {
+  uint32_t l = len;
+  if (!trace)
+    return;
+  putc(kind, trace);
+  fwrite(&l, sizeof l, 1, trace);
+  if (len)
+    fwrite(p, 1, len, trace);
+}
+
+static void putstr(const char *s) {
+  put(TR_DATA, s, s ? strlen(s) + 1 : 0);
+}
+
+/**
+ * size in bytes of a property as returned by Xlib,
+ * 32bit items are returned as longs
+ */
+static size_t propsize(const int format, const unsigned long nitems) {
+  return nitems * (format == 32 ? sizeof(long) : format == 16 ? sizeof(short) : 1);
+}
+
+/**
+ * only the leading non-zero part of an event is stored,
+ * the display pointer is meaningless to the replay
+ */
+static void putevent(const XEvent *e) {
+  XEvent ev = *e;
+  size_t len = sizeof ev;
+  ev.xany.display = NULL;
+  while (len && !((unsigned char *) &ev)[len - 1])
+    --len;
+  put(TR_EVENT, &ev, len);
+}
+
+Display *__wrap_XOpenDisplay(const char *name) {
+  Display *dpy = __real_XOpenDisplay(name);
+  const char *path = getenv("MWM_TRACE");
+  if (!dpy)
+    return NULL;
+  if (!(trace = fopen(path ? path : TRACE_FILE, "wb")))
+    err(EXIT_FAILURE, "cannot open trace %s", path ? path : TRACE_FILE);
+
+  TraceOpen o = { RootWindow(dpy, DefaultScreen(dpy)), DefaultColormap(dpy, DefaultScreen(dpy)), DefaultScreen(dpy) };
+  fwrite(TRACE_MAGIC, 1, sizeof TRACE_MAGIC - 1, trace);
+  put(TR_OPEN, &o, sizeof o);
+  return dpy;
+}
+
+int __wrap_XCloseDisplay(Display *dpy) {
+  if (trace)
+    fclose(trace);
+  trace = NULL;
+  return __real_XCloseDisplay(dpy);
+}
+
+int __wrap_XPending(Display *dpy) {
+  int n = __real_XPending(dpy);
+  put(TR_PENDING, &n, sizeof n);
+  return n;
+}
+
+int __wrap_XNextEvent(Display *dpy, XEvent *e) {
+  int r = __real_XNextEvent(dpy, e);
+  putevent(e);
+  return r;
+}
+
+int __wrap_XMaskEvent(Display *dpy, long mask, XEvent *e) {
+  int r = __real_XMaskEvent(dpy, mask, e);
+  putevent(e);
+  return r;
+}
+
+int __wrap_poll(struct pollfd *fds, nfds_t n, int timeout) {
+  int r = __real_poll(fds, n, timeout);
+  put(TR_POLL, &r, sizeof r);
+  return r;
+}
+
+int __wrap_clock_gettime(clockid_t id, struct timespec *ts) {
+  int r = __real_clock_gettime(id, ts);
+  put(TR_CLOCK, ts, sizeof *ts);
+  return r;
+}
+
+/**
+ * flush before forking so a child exiting
+ * does not write the buffer a second time
+ */
+pid_t __wrap_fork(void) {
+  if (trace)
+    fflush(trace);
+  return __real_fork();
+}
+
+Status __wrap_XGetWindowAttributes(Display *dpy, Window w, XWindowAttributes *wa) {
+  Status s = __real_XGetWindowAttributes(dpy, w, wa);
+  put(TR_ATTRIBUTES, &s, sizeof s);
+  if (s)
+    put(TR_DATA, wa, sizeof *wa);
+  return s;
+}
+
+Status __wrap_XGetClassHint(Display *dpy, Window w, XClassHint *ch) {
+  Status s = __real_XGetClassHint(dpy, w, ch);
+  put(TR_CLASSHINT, &s, sizeof s);
+  if (s) {
+    putstr(ch->res_name);
+    putstr(ch->res_class);
+  }
+  return s;
+}
+
+Status __wrap_XGetTextProperty(Display *dpy, Window w, XTextProperty *tp, Atom a) {
+  TraceTextProp t = { __real_XGetTextProperty(dpy, w, tp, a), 0, 0, 0 };
+  if (t.status) {
+    t.encoding = tp->encoding;
+    t.format = tp->format;
+    t.nitems = tp->nitems;
+  }
+  put(TR_TEXTPROP, &t, sizeof t);
+  if (t.status)
+    put(TR_DATA, tp->value, tp->value ? propsize(t.format, t.nitems) : 0);
+  return t.status;
+}
+
+int __wrap_XmbTextPropertyToTextList(Display *dpy, const XTextProperty *tp, char ***list, int *n) {
+  int r[2] = { __real_XmbTextPropertyToTextList(dpy, tp, list, n), 0 };
+  if (r[0] >= Success)
+    r[1] = *n;
+  put(TR_TEXTLIST, r, sizeof r);
+  for (int i = 0; i < r[1]; i++)
+    putstr((*list)[i]);
+  return r[0];
+}
+
+Status __wrap_XGetTransientForHint(Display *dpy, Window w, Window *t) {
+  Status s = __real_XGetTransientForHint(dpy, w, t);
+  put(TR_TRANSIENT, &s, sizeof s);
+  if (s)
+    put(TR_DATA, t, sizeof *t);
+  return s;
+}
+
+XWMHints *__wrap_XGetWMHints(Display *dpy, Window w) {
+  XWMHints *wmh = __real_XGetWMHints(dpy, w);
+  put(TR_WMHINTS, wmh, wmh ? sizeof *wmh : 0);
+  return wmh;
+}
+
+Status __wrap_XGetWMProtocols(Display *dpy, Window w, Atom **prot, int *n) {
+  Status s = __real_XGetWMProtocols(dpy, w, prot, n);
+  put(TR_PROTOCOLS, &s, sizeof s);
+  if (s)
+    put(TR_DATA, *prot, *n * sizeof(Atom));
+  return s;
+}
+
+int __wrap_XGetWindowProperty(Display *dpy, Window w, Atom prop, long off, long len, Bool del, Atom req,
+    Atom *type, int *format, unsigned long *nitems, unsigned long *after, unsigned char **data) {
+  TraceProperty t = { __real_XGetWindowProperty(dpy, w, prop, off, len, del, req, type, format, nitems, after, data), 0, 0, 0, 0 };
+  if (t.status == Success) {
+    t.type = *type;
+    t.format = *format;
+    t.nitems = *nitems;
+    t.after = *after;
+  }
+  put(TR_PROPERTY, &t, sizeof t);
+  if (t.status == Success)
+    put(TR_DATA, *data, *data ? propsize(t.format, t.nitems) : 0);
+  return t.status;
+}
+
+Bool __wrap_XQueryPointer(Display *dpy, Window w, Window *root, Window *child,
+    int *rx, int *ry, int *wx, int *wy, unsigned int *mask) {
+  TracePointer t = { __real_XQueryPointer(dpy, w, root, child, rx, ry, wx, wy, mask), 0, 0, 0, 0, 0, 0, 0 };
+  t.root = *root;
+  t.child = *child;
+  t.rx = *rx;
+  t.ry = *ry;
+  t.wx = *wx;
+  t.wy = *wy;
+  t.mask = *mask;
+  put(TR_POINTER, &t, sizeof t);
+  return t.status;
+}
+
+Status __wrap_XQueryTree(Display *dpy, Window w, Window *root, Window *parent, Window **children, unsigned int *n) {
+  TraceTree t = { __real_XQueryTree(dpy, w, root, parent, children, n), 0, 0 };
+  if (t.status) {
+    t.root = *root;
+    t.parent = *parent;
+  }
+  put(TR_TREE, &t, sizeof t);
+  if (t.status)
+    put(TR_DATA, *children, *children ? *n * sizeof(Window) : 0);
+  return t.status;
+}
+
+Atom __wrap_XInternAtom(Display *dpy, const char *name, Bool exists) {
+  Atom a = __real_XInternAtom(dpy, name, exists);
+  put(TR_ATOM, &a, sizeof a);
+  return a;
+}
+
+Status __wrap_XAllocNamedColor(Display *dpy, Colormap map, const char *name, XColor *s, XColor *e) {
+  Status st = __real_XAllocNamedColor(dpy, map, name, s, e);
+  put(TR_COLOR, &st, sizeof st);
+  if (st) {
+    put(TR_DATA, s, sizeof *s);
+    put(TR_DATA, e, sizeof *e);
+  }
+  return st;
+}
+
+XModifierKeymap *__wrap_XGetModifierMapping(Display *dpy) {
+  XModifierKeymap *map = __real_XGetModifierMapping(dpy);
+  int n = map ? map->max_keypermod : -1;
+  put(TR_MODMAP, &n, sizeof n);
+  if (map)
+    put(TR_DATA, map->modifiermap, 8 * n);
+  return map;
+}
+
+KeyCode __wrap_XKeysymToKeycode(Display *dpy, KeySym sym) {
+  KeyCode code = __real_XKeysymToKeycode(dpy, sym);
+  put(TR_KEYCODE, &code, sizeof code);
+  return code;
+}
+
+#if NeedWidePrototypes
+KeySym __wrap_XkbKeycodeToKeysym(Display *dpy, unsigned int code, int group, int level) {
+#else
+KeySym __wrap_XkbKeycodeToKeysym(Display *dpy, KeyCode code, int group, int level) {
+#endif
+  KeySym sym = __real_XkbKeycodeToKeysym(dpy, code, group, level);
+  put(TR_KEYSYM, &sym, sizeof sym);
+  return sym;
+}
+
+KeySym __wrap_XStringToKeysym(const char *s) {
+  KeySym sym = __real_XStringToKeysym(s);
+  put(TR_KEYSYM, &sym, sizeof sym);
+  return sym;
+}
+
+/**
+ * read the rc file whole into the trace, and parse that copy,
+ * so that the replay parses exactly what was parsed here
+ */
+int __wrap_rcread(const char *path, void (*f)(int, char *[], int, void *), void *arg) {
+  FILE *fp = fopen(path, "r");
+  char buf[4096], *text = NULL;
+  size_t len = 0, n;
+  int r = fp ? 0 : -1;
+  while (fp && (n = fread(buf, 1, sizeof buf, fp)) > 0) {
+    if (!(text = realloc(text, len + n)))
+      err(EXIT_FAILURE, "cannot read %s", path);
+    memcpy(text + len, buf, n);
+    len += n;
+  }
+  if (fp)
+    fclose(fp);
+  put(TR_RC, &r, sizeof r);
+  if (!r)
+    put(TR_DATA, text, len);
+  if (len && (fp = fmemopen(text, len, "r"))) {
+    rcparse(fp, f, arg);
+    fclose(fp);
+  }
+  free(text);
+  return r;
+}
+
+XineramaScreenInfo *__wrap_XineramaQueryScreens(Display *dpy, int *n) {
+  XineramaScreenInfo *info = __real_XineramaQueryScreens(dpy, n);
+  put(TR_SCREENS, n, sizeof *n);
+  put(TR_DATA, info, info ? *n * sizeof *info : 0);
+  return info;
+}
+
+int __wrap_XGrabPointer(Display *dpy, Window w, Bool owner, unsigned int mask,
+    int pmode, int kmode, Window confine, Cursor cursor, Time t) {
+  int r = __real_XGrabPointer(dpy, w, owner, mask, pmode, kmode, confine, cursor, t);
+  put(TR_GRAB, &r, sizeof r);
+  return r;
+}
+
+int __wrap_XGrabKeyboard(Display *dpy, Window w, Bool owner, int pmode, int kmode, Time t) {
+  int r = __real_XGrabKeyboard(dpy, w, owner, pmode, kmode, t);
+  put(TR_GRAB, &r, sizeof r);
+  return r;
+}
+
+Bool __wrap_XRRQueryExtension(Display *dpy, int *event, int *error) {
+  TraceExtension t = { __real_XRRQueryExtension(dpy, event, error), 0, 0 };
+  if (t.present) {
+    t.event = *event;
+    t.error = *error;
+  }
+  put(TR_EXTENSION, &t, sizeof t);
+  return t.present;
+}
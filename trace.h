@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * binary X trace, see trace.c (recorder) and replay.c (stub backend)
+ *
+ * a trace starts with the magic and a TR_OPEN record, followed by
+ * one record per call through which mwm received data from the
+ * server or the system, in the order the calls were made.
+ * a record is a kind byte, a 32bit length and the payload.
+ * variable sized replies (strings, lists) follow their call
+ * record as TR_DATA records, a NULL pointer has length 0.
+ * the rc file is recorded whole each time it is read, so the
+ * bindings replayed are those of the recorded session.
+ *
+ * the trace is only meaningful to a binary of the same architecture.
+ */
+#define TRACE_MAGIC "MWMT\2"
+#define TRACE_FILE  "mwm.trace" /* unless set through MWM_TRACE */
+
+enum { TR_OPEN, TR_DATA, TR_PENDING, TR_EVENT, TR_POLL, TR_CLOCK,
+       TR_ATTRIBUTES, TR_CLASSHINT, TR_TEXTPROP, TR_TEXTLIST, TR_TRANSIENT,
+       TR_WMHINTS, TR_PROTOCOLS, TR_PROPERTY, TR_POINTER, TR_TREE, TR_ATOM,
+       TR_COLOR, TR_MODMAP, TR_KEYCODE, TR_KEYSYM, TR_SCREENS, TR_GRAB, TR_EXTENSION,
+       TR_RC, TR_KINDS };
+
+typedef struct {
+  Window root;
+  Colormap cmap;
+  int screen;
+} TraceOpen;
+
+typedef struct {
+  Status status;
+  Atom encoding;
+  int format;
+  unsigned long nitems;
+} TraceTextProp;
+
+typedef struct {
+  int status;
+  Atom type;
+  int format;
+  unsigned long nitems, after;
+} TraceProperty;
+
+typedef struct {
+  Bool status;
+  Window root, child;
+  int rx, ry, wx, wy;
+  unsigned int mask;
+} TracePointer;
+
+typedef struct {
+  Status status;
+  Window root, parent;
+} TraceTree;
+
+typedef struct {
+  Bool present;
+  int event, error; /* first codes */
+} TraceExtension;
+
+#endif